@@ -1,54 +1,737 @@
-String sendMessage;
-String receivedMessage;
+// Binäres Rahmenprotokoll (Gegenstück in pc_application/src/protocol.h):
+//   [SYNC 0xA5][LEN][SEQ][OP][PAYLOAD: LEN Bytes][CRC-8 über LEN..PAYLOAD]
+// Zahlen werden als gepackte Dezimalziffern übertragen (zwei Zeichen pro Byte), oder mit
+// OP_CALC_F32/OP_EXEC_F32 direkt als 4-Byte-float: dann rechnet der Sketch ohne atof/dtostrf.
+// Das alte Textprotokoll "a+b\n" bleibt für den seriellen Monitor erhalten.
+//
+// Der gesamte Empfangs- und Rechenweg kommt ohne Heap aus: Zeilen und Rahmen werden in
+// festen Puffern gesammelt, der Ausdruck wird an Ort und Stelle zerlegt (der Operator wird
+// durch '\0' ersetzt) und das Ergebnis mit dtostrf in einen statischen Puffer formatiert.
+// Gerechnet wird in float: double ist auf dem AVR ebenfalls nur 32 Bit breit, und so rundet
+// die Übersetzung auf dem PC (host/) genau wie das Gerät.
+//
+// Zyklusbudget pro Nachricht (Richtwerte für avr-libc bei 16 MHz):
+//   Byte empfangen (Serial.read + Zustandsautomat)    ~   60 Zyklen/Byte
+//   CRC-8 bitweise                                     ~   70 Zyklen/Byte
+//   Operator suchen                                    ~   10 Zyklen/Zeichen
+//   atof, je Operand                                   ~ 1500-3000 Zyklen
+//   Rechnung (+ - * ~100-150, / ~500)                  ~  100-500 Zyklen
+//   dtostrf mit 4 Nachkommastellen                     ~ 2500-5000 Zyklen
+//   Antwort packen und senden (Serial.write gepuffert) ~   80 Zyklen/Byte
+// Zusammen ~6000-10000 Zyklen für "a<op>b". Pro empfangenem Byte stehen
+// 16000000 * 10 / Baudrate Zyklen zur Verfügung: 16667 bei 9600, 1389 bei 115200
+// und 160 bei 1M Baud. Ein Rahmen mit ~8 Bytes lässt damit bis etwa 115200 Baud
+// genug Luft, darüber begrenzen die Textumwandlungen (atof/dtostrf) den Durchsatz.
+// OP_CALC_F32 (14 Byte) und OP_RESULT_F32 (9 Byte) sparen beide Umwandlungen: es
+// bleiben ~1500-2000 Zyklen, fast nur noch Empfang, CRC und Senden. OP_CALC_BATCH
+// verteilt Rahmen, CRC und Schleifendurchlauf zusätzlich auf bis zu 24 Rechnungen.
+// Auch im Text- und OP_CALC-Weg entfallen atof und dtostrf, wenn beide Operanden
+// ganze Zahlen oder Dezimalzahlen mit höchstens 4 Nachkommastellen sind und das
+// Ergebnis exakt gleich dem float-Weg ist (FastResult): Zerlegen, Rechnen und
+// Formatieren in Ganzzahlen kosten dann ~300-1200 Zyklen statt ~6000-10000.
+// Bleibt es beim float-Weg, ersetzen ParseNumber und FormatDecimal atof und dtostrf
+// für die üblichen Fälle (bis 10 Nachkommastellen bzw. Ergebnisse unter 1000):
+// dieselben float-Multiplikationen wie atof ohne dessen Zeichenschleife bzw. eine
+// 64-Bit-Multiplikation und Schiebungen (~600-900 Zyklen), bitgleich mit atof bzw. dtostrf.
+//
+// Empfang und Auswertung überlappen: Der Core empfängt per USART-Interrupt in seinen
+// 64-Byte-Ring. loop() setzt daraus Zeilen und Rahmen zusammen und übergibt jede fertige
+// Nachricht an einen zweiten Puffer (readyBuffer, Rahmen durch Zeigertausch). Ausgewertet
+// wird erst danach, und die Antwort geht in eine eigene Sendewarteschlange, die loop()
+// nur so weit leert, wie der Sendepuffer des Cores Platz hat. Während Nachricht N
+// ausgewertet und gesendet wird, läuft N+1 also schon ein, und Serial.write blockiert
+// nicht mehr, bis der Core-Puffer frei ist (z.B. bei der 105-Byte-Antwort eines Batches).
+#include <stdlib.h>
+#include <string.h>
+
+const byte FRAME_SYNC = 0xA5;
+// Rahmen landen in messageBuffers (HandOff/ProcessReady), die FRAME_MAX_BATCH_PAYLOAD fassen.
+// Alle Opcodes außer OP_CALC_BATCH begrenzt darunter textBuffer bzw. die gepackte Antwort.
+const byte FRAME_MAX_PAYLOAD = 48;         // Außer OP_CALC_BATCH: 2 * 48 + 1 Zeichen entpackt
+const byte BATCH_MAX_COUNT = 24;           // Rechnungen pro OP_CALC_BATCH: 2 Rahmenpuffer je 222 + Antwort 100 Byte Stack, ~27 % der 2 KB SRAM
+const byte FRAME_MAX_BATCH_PAYLOAD = 2 + BATCH_MAX_COUNT * 9;  // 218 Byte, nur für OP_CALC_BATCH
+const unsigned long FRAME_TIMEOUT_MS = 50;  // Unvollständige Rahmen nach dieser Zeit verwerfen
+const byte LINE_BUFFER_SIZE = 64;           // Maximale Länge einer Zeile im Textprotokoll
+const byte TEXT_BUFFER_SIZE = 2 * FRAME_MAX_PAYLOAD + 1;  // Entpackter Ausdruck aus einem Rahmen
+const byte RESULT_BUFFER_SIZE = 48;         // dtostrf: bis zu 39 Vorkommastellen + Vorzeichen + ".dddd"
+const byte OUTPUT_BUFFER_SIZE = 128;        // Sendewarteschlange, Zweierpotenz
+const byte REPLY_MAX_SIZE = 5 + 1 + (BATCH_MAX_COUNT + 7) / 8 + BATCH_MAX_COUNT * 4;  // 105: OP_RESULT_BATCH
+
+const byte READY_NONE = 0;           // readyBuffer ist frei
+const byte READY_LINE = 1;           // Textzeile, readyLength Zeichen
+const byte READY_LINE_OVERFLOW = 2;  // Zu lange Textzeile, nur die Fehlermeldung
+const byte READY_FRAME = 3;          // Rahmen ohne SYNC, CRC noch nicht geprüft
+
+const byte OP_CALC = 0x01;         // Gepackter Ausdruck "a<op>b"
+const byte OP_PING = 0x02;         // Heartbeat des PCs
+const byte OP_HELLO = 0x03;        // Abfrage von Version und Fähigkeiten
+const byte OP_SET_BAUD = 0x04;     // Index in BAUD_RATES, Bestätigung noch mit alter Rate
+const byte OP_ECHO = 0x05;         // Nutzdaten unverändert zurückschicken
+const byte OP_EXEC = 0x06;         // Bytecode für die Stack-VM
+const byte OP_CALC_F32 = 0x07;     // a (float LE), Operator (ASCII), b (float LE), Antwort OP_RESULT_F32
+const byte OP_EXEC_F32 = 0x08;     // Bytecode wie OP_EXEC, Antwort OP_RESULT_F32
+const byte OP_CALC_BATCH = 0x09;   // Anzahl, gemeinsamer Operator oder 0, je Rechnung [Operator] a b (float LE)
+const byte OP_COMMIT_BAUD = 0x0A;  // PC hat das Echo mit der neuen Rate erhalten: Probezeit beenden
+const byte OP_RESULT = 0x81;       // Gepacktes Ergebnis ohne Nullen am Ende
+const byte OP_RESULT_TEXT = 0x82;  // Ergebnis als ASCII (z.B. "INF")
+const byte OP_PONG = 0x83;         // Antwort auf OP_PING
+const byte OP_HELLO_REPLY = 0x84;  // Version, Features (16 Bit LE), Maske der Baudraten
+const byte OP_ACK = 0x85;          // Bestätigung
+const byte OP_ECHO_REPLY = 0x86;   // Antwort auf OP_ECHO
+const byte OP_RESULT_F32 = 0x87;   // Ergebnis als float (4 Byte LE), der PC formatiert
+const byte OP_RESULT_BATCH = 0x88; // Anzahl, Fehlermaske (1 Bit je Rechnung), je Rechnung float oder Fehlercode
+const byte OP_ERROR = 0xE0;        // 1 Byte Fehlercode
+
+const byte STATUS_OK = 0;
+const byte ERR_NO_OPERATOR = 1;
+const byte ERR_DIV_ZERO = 2;
+const byte ERR_CRC = 3;
+const byte ERR_UNKNOWN_OP = 4;
+const byte ERR_BAD_PAYLOAD = 5;
+const byte ERR_BAD_BYTECODE = 6;
+
+const byte PROTOCOL_VERSION = 1;
+const unsigned int FEATURE_FRAMED = 0x0001;
+const unsigned int FEATURE_PING = 0x0002;
+const unsigned int FEATURE_BAUD_RATE = 0x0004;
+const unsigned int FEATURE_VM = 0x0008;
+const unsigned int FEATURE_F32 = 0x0010;
+const unsigned int FEATURE_BATCH = 0x0020;
+const unsigned int FEATURES = FEATURE_FRAMED | FEATURE_PING | FEATURE_BAUD_RATE | FEATURE_VM | FEATURE_F32 | FEATURE_BATCH;
+
+// Befehle der Stack-VM (Gegenstück in pc_application/src/expressioncompiler.h).
+// Der PC löst Rangfolge und Klammern auf und schickt fertigen Postfix-Code.
+const byte VM_PUSH_F32 = 0x01;  // + 4 Byte float, little endian
+const byte VM_PUSH_I8 = 0x02;   // + 1 Byte Ganzzahl mit Vorzeichen
+const byte VM_ADD = 0x10;
+const byte VM_SUB = 0x11;
+const byte VM_MUL = 0x12;
+const byte VM_DIV = 0x13;
+const byte VM_NEG = 0x14;
+const byte VM_STACK_SIZE = 16;
+
+// Aushandelbare Baudraten (Index = Bit in der Maske). Bei 16 MHz sind 250k, 500k und 1M exakt.
+const unsigned long BAUD_RATES[] = { 9600, 115200, 250000, 500000, 1000000 };
+const byte BAUD_RATE_COUNT = 5;
+const byte BAUD_RATE_MASK = 0x1F;
+const unsigned long BAUD_PROBATION_MS = 2000;  // Ohne OP_COMMIT_BAUD zurück auf 9600, jeder gültige Rahmen verlängert
+
+// Festkomma-Abkürzung (FastResult). Ganze Zahlen bis 2^24 stellt float exakt dar,
+// Ergebnisse unter 10^7 gibt dtostrf mit allen Stellen aus. Bei Nachkommastellen
+// multipliziert atof mit bis zu zwei gerundeten Faktoren 10^-k (relativer Fehler je
+// Operand höchstens 4 * 2^-24), die Summe rundet noch einmal: Unter 64 bleibt der Fehler
+// kleiner als 5e-5, dtostrf rundet dann auf genau die Dezimalzahl der Ganzzahlrechnung.
+const byte FIXED_DECIMALS = 4;                      // Nachkommastellen der Ausgabe
+const unsigned long FIXED_MAX_INTEGER = 16777216;   // 2^24
+const unsigned long FIXED_MAX_WHOLE = 10000000;     // Ergebnis ohne Nachkommastellen: < 10^7
+const unsigned long FIXED_MAX_SCALED = 640000;      // Mit Nachkommastellen: < 64 * 10^4
+const unsigned long POWERS_OF_TEN[] = { 1000000, 100000, 10000, 1000, 100, 10, 1 };
+// ParseNumber: Mantisse bis 2^24 ist als float exakt, danach wie avr-libc strtod je
+// gesetztem Bit der Nachkommastellen ein Faktor 10^-8, 10^-4, 10^-2, 10^-1 (gleiche
+// Reihenfolge, gleiche Rundung). FormatDecimal: Beträge unter 1000 (höchstens 7 Stellen).
+const byte NUMBER_MAX_DECIMALS = 10;
+const float NEGATIVE_POWERS[] = { 1e-1, 1e-2, 1e-4, 1e-8 };  // 10^-(2^i), wie pwr_m10
+const byte FORMAT_MAX_EXPONENT = 127 + 10;         // Biased Exponent ab 2^10 = 1024: dtostrf
+
+const char NIBBLE_CHARS[] = "0123456789.-+*/";  // Index = Nibble-Wert, 0xF = Füllwert
+const byte NIBBLE_PAD = 0x0F;
+
+char lineBuffer[LINE_BUFFER_SIZE + 1];    // Textprotokoll: aktuelle Zeile, +1 für '\0'
+byte lineLength = 0;                      // Anzahl Zeichen in lineBuffer
+bool lineOverflow = false;                // Zeile war zu lang und wird verworfen
+char textBuffer[TEXT_BUFFER_SIZE];        // Entpackter Ausdruck aus einem Rahmen
+char resultBuffer[RESULT_BUFFER_SIZE];    // Formatiertes Ergebnis
+
+byte messageBuffers[2][FRAME_MAX_BATCH_PAYLOAD + 4];  // Empfang und Auswertung im Wechsel
+byte *frameBuffer = messageBuffers[0];    // Empfang: LEN, SEQ, OP, PAYLOAD, CRC (ohne SYNC)
+byte *readyBuffer = messageBuffers[1];    // Fertige Nachricht, wartet auf Auswertung
+byte readyKind = READY_NONE;              // Art der Nachricht in readyBuffer
+byte readyLength = 0;                     // READY_LINE: Anzahl Zeichen
+byte frameIndex = 0;                      // Anzahl bereits empfangener Rahmenbytes
+bool inFrame = false;                     // true, sobald ein Sync-Byte empfangen wurde
+unsigned long lastFrameByte = 0;          // Zeitpunkt des letzten Rahmenbytes
+bool baudProbation = false;               // Neue Baudrate ist noch nicht bestätigt
+unsigned long baudSwitchTime = 0;         // Beginn der Probezeit: Wechsel oder letzter gültiger Rahmen
+byte outputBuffer[OUTPUT_BUFFER_SIZE];    // Antworten, die noch nicht im Sendepuffer des Cores sind
+byte outputHead = 0;                      // Nächstes zu sendendes Byte
+byte outputCount = 0;                     // Belegte Bytes in outputBuffer
+
+// Operand als Dezimalzahl: Wert = mantissa / 10^decimals, Vorzeichen getrennt (auch -0)
+struct FixedNumber {
+  bool negative;
+  byte decimals;
+  unsigned long mantissa;
+};
+
+void HandleLineByte(char receivedChar);
+void HandleFrameByte(byte b);
+void HandOff(byte kind);
+void ProcessReady();
+void HandleFrame(const byte *frame);
+void ProcessFrame(byte seq, byte opcode, const byte *payload, byte length);
+void OutputWrite(const byte *data, byte length);
+void OutputLine(const char *text);
+void PumpOutput();
+void FlushOutput();
+void SwitchBaudRate(unsigned long baudRate, bool probation);
+void SendError(byte seq, byte code);
+void SendFrame(byte seq, byte opcode, const byte *payload, byte length);
+byte Crc8(const byte *data, byte length, byte crc);
+byte UnpackDecimal(const byte *packed, byte length, char *text);
+byte PackDecimal(const char *text, byte *packed);
+const char *GetResult(char *input, byte length);
+char *FastResult(const char *input, byte length);
+bool ParseFixed(const char *text, const char *end, FixedNumber &number, byte maxDecimals);
+float ParseNumber(const char *text);
+char *FormatDecimal(float result);
+char *FormatFixed(bool negative, unsigned long whole, unsigned int fraction);
+char *AppendDigits(char *out, unsigned long value, byte first, bool pad);
+byte Calculate(char *input, byte length, float &result);
+byte CalculateF32(const byte *payload, byte length, float &result);
+byte Apply(char operation, float num1, float num2, float &result);
+bool IsOperator(char operation);
+void RunBatch(byte seq, const byte *payload, byte length);
+byte RunBytecode(const byte *code, byte length, float &result);
+void SendResult(byte seq, float result);
+void SendFormatted(byte seq, char *s_result);
+char *FormatResult(float result);
 
 void setup() {
   Serial.begin(9600);  //serielle Transferrate wird auf 9600 gesetzt
 }
 
 void loop() {
-  // auf serielle Eingabe warten
+  // Abgebrochenen Rahmen verwerfen, damit der Empfang nicht hängen bleibt
+  if (inFrame && millis() - lastFrameByte > FRAME_TIMEOUT_MS) { inFrame = false; }
+  // Neue Baudrate wurde vom PC nicht bestätigt: zurück auf die Startrate
+  if (baudProbation && millis() - baudSwitchTime > BAUD_PROBATION_MS) { SwitchBaudRate(BAUD_RATES[0], false); }
+
+  // auf serielle Eingabe warten, fertige Nachrichten gehen an readyBuffer
   while (Serial.available() > 0) {
-    char receivedChar = Serial.read();
-    if (receivedChar == '\n' || receivedChar == '\r') {  // Prüft auf beides!
-      if (receivedMessage.length() > 0) {                // Nur verarbeiten, wenn wirklich etwas empfangen wurde
-        String Result = GetResult(receivedMessage);
-        Serial.println(Result);
-        receivedMessage = "";  // Reset für die nächste Nachricht
-      }
-    } else if (receivedChar == "") {
-      String Result = GetResult(receivedMessage) + "";
-      Serial.println(Result);
-      receivedMessage = "";  // Zurücksetzen der empfangenen Nachricht
+    byte receivedByte = Serial.read();
+    if (inFrame || receivedByte == FRAME_SYNC) {  // Binärrahmen, 0xA5 kommt im Text nie vor
+      HandleFrameByte(receivedByte);
+    } else {
+      HandleLineByte((char)receivedByte);
+    }
+  }
+  // Erst auswerten, wenn die größte Antwort in die Warteschlange passt; bis dahin empfängt
+  // der nächste Durchlauf weiter
+  if (readyKind != READY_NONE && OUTPUT_BUFFER_SIZE - outputCount >= REPLY_MAX_SIZE) { ProcessReady(); }
+  PumpOutput();
+}
+
+// Fertige Nachricht übergeben. Ist readyBuffer noch belegt, wird die ältere zuerst
+// ausgewertet, die Reihenfolge der Antworten bleibt so erhalten.
+void HandOff(byte kind) {
+  if (readyKind != READY_NONE) { ProcessReady(); }
+  if (kind == READY_FRAME) {  // Zeigertausch, der Empfang schreibt in den freien Puffer weiter
+    byte *received = frameBuffer;
+    frameBuffer = readyBuffer;
+    readyBuffer = received;
+  } else if (kind == READY_LINE) {
+    memcpy(readyBuffer, lineBuffer, lineLength);
+    readyLength = lineLength;
+  }
+  readyKind = kind;
+}
+
+void ProcessReady() {
+  byte kind = readyKind;
+  readyKind = READY_NONE;
+  if (kind == READY_LINE) {
+    OutputLine(GetResult((char *)readyBuffer, readyLength));
+  } else if (kind == READY_LINE_OVERFLOW) {
+    OutputLine("Error: input too long");
+  } else if (kind == READY_FRAME) {
+    HandleFrame(readyBuffer);
+  }
+}
+
+// Textprotokoll: Zeichen sammeln, bei '\n' oder '\r' auswerten
+void HandleLineByte(char receivedChar) {
+  if (receivedChar == '\n' || receivedChar == '\r') {  // Prüft auf beides!
+    if (lineOverflow) {
+      HandOff(READY_LINE_OVERFLOW);
+    } else if (lineLength > 0) {  // Nur verarbeiten, wenn wirklich etwas empfangen wurde
+      HandOff(READY_LINE);
+    }
+    lineLength = 0;  // Reset für die nächste Nachricht
+    lineOverflow = false;
+    return;
+  }
+  if (lineLength >= LINE_BUFFER_SIZE) {
+    lineOverflow = true;  // Rest der Zeile verwerfen, statt den Speicher zu überschreiben
+    return;
+  }
+  lineBuffer[lineLength++] = receivedChar;  // Anhängen von Zeichen an die empfangene Nachricht
+}
+
+// Sammelt die Bytes eines Rahmens und übergibt ihn, sobald er vollständig ist
+void HandleFrameByte(byte b) {
+  lastFrameByte = millis();
+  if (!inFrame) {  // Sync-Byte
+    inFrame = true;
+    frameIndex = 0;
+    return;
+  }
+  frameBuffer[frameIndex++] = b;
+  if (frameBuffer[0] > FRAME_MAX_BATCH_PAYLOAD) {  // Ungültige Länge: neu synchronisieren
+    inFrame = false;
+    return;
+  }
+  if (frameIndex < frameBuffer[0] + 4) { return; }  // Rahmen noch unvollständig
+
+  inFrame = false;
+  HandOff(READY_FRAME);
+}
+
+// Vollständiger Rahmen ohne SYNC: CRC prüfen und auswerten
+void HandleFrame(const byte *frame) {
+  byte length = frame[0];
+  byte seq = frame[1];
+  byte opcode = frame[2];
+  if (Crc8(frame, length + 3, 0) != frame[length + 3]) {
+    SendError(seq, ERR_CRC);  // PC wiederholt die Anfrage sofort, ohne auf einen Timeout zu warten
+    return;
+  }
+  // Gültiger Rahmen: Probezeit neu starten, damit der PC OP_COMMIT_BAUD wiederholen kann.
+  // Beendet wird sie erst durch OP_COMMIT_BAUD, denn die Antwort könnte noch verloren gehen.
+  if (baudProbation) { baudSwitchTime = millis(); }
+  ProcessFrame(seq, opcode, frame + 3, length);
+}
+
+void ProcessFrame(byte seq, byte opcode, const byte *payload, byte length) {
+  if (opcode == OP_CALC_BATCH) {
+    RunBatch(seq, payload, length);
+    return;
+  }
+  if (length > FRAME_MAX_PAYLOAD) {  // Größere Rahmen gibt es nur für OP_CALC_BATCH (textBuffer!)
+    SendError(seq, ERR_BAD_PAYLOAD);
+    return;
+  }
+  if (opcode == OP_PING) {
+    SendFrame(seq, OP_PONG, NULL, 0);
+    return;
+  }
+  if (opcode == OP_HELLO) {
+    byte info[4] = { PROTOCOL_VERSION, (byte)(FEATURES & 0xFF), (byte)(FEATURES >> 8), BAUD_RATE_MASK };
+    SendFrame(seq, OP_HELLO_REPLY, info, sizeof(info));
+    return;
+  }
+  if (opcode == OP_SET_BAUD) {
+    if (length != 1 || payload[0] >= BAUD_RATE_COUNT) {
+      SendError(seq, ERR_BAD_PAYLOAD);
+      return;
+    }
+    SendFrame(seq, OP_ACK, NULL, 0);  // Bestätigung noch mit der alten Rate
+    SwitchBaudRate(BAUD_RATES[payload[0]], true);
+    return;
+  }
+  if (opcode == OP_ECHO) {
+    SendFrame(seq, OP_ECHO_REPLY, payload, length);
+    return;
+  }
+  if (opcode == OP_COMMIT_BAUD) {  // Auch ohne Probezeit bestätigen: Wiederholung nach verlorenem Ack
+    baudProbation = false;
+    SendFrame(seq, OP_ACK, NULL, 0);
+    return;
+  }
+  float result;
+  byte status;
+  if (opcode == OP_CALC) {
+    byte textLength = UnpackDecimal(payload, length, textBuffer);
+    char *fast = FastResult(textBuffer, textLength);
+    if (fast != NULL) {
+      SendFormatted(seq, fast);
+      return;
+    }
+    status = Calculate(textBuffer, textLength, result);
+  } else if (opcode == OP_EXEC || opcode == OP_EXEC_F32) {
+    status = RunBytecode(payload, length, result);
+  } else if (opcode == OP_CALC_F32) {
+    status = CalculateF32(payload, length, result);
+  } else {
+    status = ERR_UNKNOWN_OP;
+  }
+  if (status != STATUS_OK) {
+    SendError(seq, status);
+    return;
+  }
+  if (opcode == OP_CALC_F32 || opcode == OP_EXEC_F32) {
+    SendFrame(seq, OP_RESULT_F32, (const byte *)&result, 4);
+    return;
+  }
+  SendResult(seq, result);
+}
+
+void SendResult(byte seq, float result) {
+  SendFormatted(seq, FormatResult(result));
+}
+
+// s_result zeigt auf resultBuffer und wird gekürzt
+void SendFormatted(byte seq, char *s_result) {
+  // Nullen am Ende weglassen, der PC ergänzt wieder auf 4 Nachkommastellen
+  byte resultLength = strlen(s_result);
+  if (strchr(s_result, '.') != NULL) {
+    while (s_result[resultLength - 1] == '0') { resultLength--; }
+    if (s_result[resultLength - 1] == '.') { resultLength--; }
+    s_result[resultLength] = '\0';
+  }
+
+  byte packed[FRAME_MAX_PAYLOAD];
+  byte packedLength = PackDecimal(s_result, packed);
+  if (packedLength == 0) {  // z.B. "INF" oder "NAN" lässt sich nicht packen
+    SendFrame(seq, OP_RESULT_TEXT, (const byte *)s_result, resultLength);
+  } else {
+    SendFrame(seq, OP_RESULT, packed, packedLength);
+  }
+}
+
+// Wartet, bis alle Bytes gesendet sind, und stellt dann die Rate um
+void SwitchBaudRate(unsigned long baudRate, bool probation) {
+  FlushOutput();
+  Serial.flush();
+  Serial.end();
+  Serial.begin(baudRate);
+  inFrame = false;
+  baudProbation = probation;
+  baudSwitchTime = millis();
+}
+
+void SendError(byte seq, byte code) {
+  SendFrame(seq, OP_ERROR, &code, 1);
+}
+
+void SendFrame(byte seq, byte opcode, const byte *payload, byte length) {
+  byte header[3] = { length, seq, opcode };
+  byte crc = Crc8(header, 3, 0);
+  crc = Crc8(payload, length, crc);
+  byte sync = FRAME_SYNC;
+  OutputWrite(&sync, 1);
+  OutputWrite(header, 3);
+  OutputWrite(payload, length);
+  OutputWrite(&crc, 1);
+}
+
+// In die Sendewarteschlange; ist sie voll, wird wie bei Serial.write gewartet
+void OutputWrite(const byte *data, byte length) {
+  for (byte i = 0; i < length; i++) {
+    while (outputCount == OUTPUT_BUFFER_SIZE) { PumpOutput(); }
+    outputBuffer[(outputHead + outputCount) & (OUTPUT_BUFFER_SIZE - 1)] = data[i];
+    outputCount++;
+  }
+}
+
+// Wie Serial.println
+void OutputLine(const char *text) {
+  OutputWrite((const byte *)text, strlen(text));
+  OutputWrite((const byte *)"\r\n", 2);
+}
+
+// Nur so viele Bytes an den Core, wie sein Sendepuffer ohne Warten aufnimmt
+void PumpOutput() {
+  int room = Serial.availableForWrite();
+  while (outputCount > 0 && room > 0) {
+    Serial.write(outputBuffer[outputHead]);
+    outputHead = (outputHead + 1) & (OUTPUT_BUFFER_SIZE - 1);
+    outputCount--;
+    room--;
+  }
+}
+
+void FlushOutput() {
+  while (outputCount > 0) { PumpOutput(); }
+}
+
+// CRC-8 mit Polynom 0x07
+byte Crc8(const byte *data, byte length, byte crc) {
+  for (byte i = 0; i < length; i++) {
+    crc ^= data[i];
+    for (byte bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x80) ? (byte)((crc << 1) ^ 0x07) : (byte)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+// Entpackt in text (mindestens 2 * length + 1 Zeichen), liefert die Anzahl Zeichen
+byte UnpackDecimal(const byte *packed, byte length, char *text) {
+  byte count = 0;
+  for (byte i = 0; i < length; i++) {
+    byte high = packed[i] >> 4;
+    byte low = packed[i] & 0x0F;
+    if (high == NIBBLE_PAD) { break; }
+    text[count++] = NIBBLE_CHARS[high];
+    if (low == NIBBLE_PAD) { break; }
+    text[count++] = NIBBLE_CHARS[low];
+  }
+  text[count] = '\0';
+  return count;
+}
+
+// Liefert die Anzahl gepackter Bytes, 0 falls ein Zeichen nicht darstellbar ist
+byte PackDecimal(const char *text, byte *packed) {
+  byte count = 0;
+  byte i = 0;
+  for (; text[i] != '\0'; i++) {
+    const char *pos = strchr(NIBBLE_CHARS, text[i]);
+    if (pos == NULL || count >= FRAME_MAX_PAYLOAD) { return 0; }
+    byte nibble = pos - NIBBLE_CHARS;
+    if (i % 2 == 0) {
+      packed[count] = (nibble << 4) | NIBBLE_PAD;
     } else {
-      receivedMessage += receivedChar;  // Anhängen von Zeichen an die empfangene Nachricht
+      packed[count] = (packed[count] & 0xF0) | nibble;
+      count++;
     }
   }
+  if (i % 2 == 1) { count++; }
+  return count;
 }
 
-String GetResult(String input_string) {
+// Textprotokoll: Ergebnis oder Fehlermeldung, zeigt auf einen statischen Puffer
+const char *GetResult(char *input, byte length) {
+  const char *fast = FastResult(input, length);
+  if (fast != NULL) { return fast; }
+  float result;
+  byte status = Calculate(input, length, result);
+  //Wenn der Operator nicht gefunden wurde, wird eine Fehlermeldung angezeigt
+  if (status == ERR_NO_OPERATOR) { return "Error: operation not found"; }
+  if (status == ERR_DIV_ZERO) { return "Error: divison by 0"; }
+  return FormatResult(result);
+}
+
+// "a<op>b" ganz ohne float, Ausgabe wie FormatResult. NULL, wenn der Ausdruck nicht in
+// die Festkomma-Grenzen passt: dann rechnet Calculate (auch alle Fehlerfälle).
+// input wird nicht verändert.
+char *FastResult(const char *input, byte length) {
+  byte operator_index = 0;
+  for (byte i = 1; i < length; i++) {  // Wie in Calculate: erster Operator ab Index 1
+    if (IsOperator(input[i])) {
+      operator_index = i;
+      break;
+    }
+  }
+  if (operator_index == 0) { return NULL; }
+  FixedNumber a, b;
+  if (!ParseFixed(input, input + operator_index, a, FIXED_DECIMALS)) { return NULL; }
+  if (!ParseFixed(input + operator_index + 1, input + length, b, FIXED_DECIMALS)) { return NULL; }
+  char operation = input[operator_index];
+
+  if (a.decimals == 0 && b.decimals == 0) {
+    if (a.mantissa > FIXED_MAX_INTEGER || b.mantissa > FIXED_MAX_INTEGER) { return NULL; }
+    unsigned long whole;
+    bool negative = a.negative != b.negative;  // Für * und /, auch bei Null wie IEEE
+    if (operation == '*') {
+      // Beide < 3163: Produkt < 10^7, die Division zur Überlaufprüfung entfällt
+      unsigned long small = a.mantissa < b.mantissa ? a.mantissa : b.mantissa;
+      unsigned long large = a.mantissa < b.mantissa ? b.mantissa : a.mantissa;
+      if (large > 3162 && small > 1 && large > (FIXED_MAX_WHOLE - 1) / small) { return NULL; }
+      whole = a.mantissa * b.mantissa;
+    } else if (operation == '/') {
+      if (b.mantissa == 0) { return NULL; }  // Fehlermeldung kommt aus Calculate
+      whole = a.mantissa / b.mantissa;
+      if (whole * b.mantissa != a.mantissa) { return NULL; }  // Nur glatte Quotienten sind exakt
+    } else {
+      long sum = (a.negative ? -(long)a.mantissa : (long)a.mantissa);
+      bool bNegative = b.negative != (operation == '-');
+      sum += bNegative ? -(long)b.mantissa : (long)b.mantissa;
+      negative = sum < 0 || (sum == 0 && a.negative && bNegative);  // Nur -0 + -0 ergibt -0
+      whole = sum < 0 ? -sum : sum;
+    }
+    if (whole >= FIXED_MAX_WHOLE) { return NULL; }
+    return FormatFixed(negative, whole, 0);
+  }
+
+  // Mit Nachkommastellen nur + und -: Produkte und Quotienten wären nicht mehr exakt
+  if (operation != '+' && operation != '-') { return NULL; }
+  unsigned long scale[2];
+  const FixedNumber *operands[2] = { &a, &b };
+  for (byte i = 0; i < 2; i++) {
+    unsigned long factor = POWERS_OF_TEN[2 + operands[i]->decimals];  // 10^(4 - decimals)
+    if (operands[i]->mantissa >= FIXED_MAX_SCALED / factor) { return NULL; }
+    scale[i] = operands[i]->mantissa * factor;
+  }
+  bool bNegative = b.negative != (operation == '-');
+  long sum = (a.negative ? -(long)scale[0] : (long)scale[0]) + (bNegative ? -(long)scale[1] : (long)scale[1]);
+  bool negative = sum < 0 || (sum == 0 && a.negative && bNegative);
+  unsigned long magnitude = sum < 0 ? -sum : sum;
+  if (magnitude >= FIXED_MAX_SCALED) { return NULL; }
+  return FormatFixed(negative, magnitude / 10000, magnitude % 10000);  // Eine Division liefert beides
+}
+
+// [+-]Ziffern[.Ziffern], mindestens eine Ziffer, höchstens maxDecimals Nachkommastellen
+bool ParseFixed(const char *text, const char *end, FixedNumber &number, byte maxDecimals) {
+  number.negative = false;
+  number.decimals = 0;
+  number.mantissa = 0;
+  if (text < end && (*text == '+' || *text == '-')) {
+    number.negative = *text == '-';
+    text++;
+  }
+  bool point = false;
+  bool digits = false;
+  for (; text < end; text++) {
+    char c = *text;
+    if (c == '.' && !point) {
+      point = true;
+      continue;
+    }
+    if (c < '0' || c > '9') { return false; }
+    if (point && ++number.decimals > maxDecimals) { return false; }
+    if (number.mantissa >= 100000000) { return false; }  // Mal 10 passt sonst nicht mehr in 32 Bit
+    number.mantissa = number.mantissa * 10 + (c - '0');
+    digits = true;
+  }
+  return digits;
+}
+
+// "[-]Ganzzahl.dddd" in resultBuffer, wie dtostrf(result, 6, 4) (Breite 6 füllt hier nie auf)
+char *FormatFixed(bool negative, unsigned long whole, unsigned int fraction) {
+  char *out = resultBuffer;
+  if (negative) { *out++ = '-'; }
+  out = AppendDigits(out, whole, 0, false);
+  *out++ = '.';
+  out = AppendDigits(out, fraction, 3, true);
+  *out = '\0';
+  return resultBuffer;
+}
+
+// Ziffern ab POWERS_OF_TEN[first] durch Abziehen statt Division (der AVR dividiert in Software)
+char *AppendDigits(char *out, unsigned long value, byte first, bool pad) {
+  for (byte i = first; i < 7; i++) {
+    char digit = '0';
+    while (value >= POWERS_OF_TEN[i]) {
+      value -= POWERS_OF_TEN[i];
+      digit++;
+    }
+    if (digit != '0' || pad || i == 6) {
+      *out++ = digit;
+      pad = true;  // Nach der ersten Ziffer auch Nullen ausgeben
+    }
+  }
+  return out;
+}
+
+// Wie atof, aber ohne dessen allgemeine Zeichen- und Exponentenbehandlung, wenn die Zahl
+// schlicht genug ist. Alles andere (Exponent, Leerzeichen, "inf", lange Mantissen) geht
+// weiter an atof.
+float ParseNumber(const char *text) {
+  FixedNumber number;
+  if (!ParseFixed(text, text + strlen(text), number, NUMBER_MAX_DECIMALS)) { return atof(text); }
+  if (number.mantissa > FIXED_MAX_INTEGER) { return atof(text); }
+  float value = number.mantissa;
+  if (number.negative) { value = -value; }
+  if (value == 0) { return value; }  // atof multipliziert Null nicht
+  for (byte bit = 4; bit-- > 0;) {
+    if (number.decimals & (1 << bit)) { value *= NEGATIVE_POWERS[bit]; }
+  }
+  return value;
+}
+
+// Wie dtostrf(result, 6, 4) für Beträge unter 1000, sonst NULL. Rechnet exakt mit den Bits
+// des floats: Mantisse * 10^4 / 2^-Exponent, genau halbe Stellen von der Null weg wie avr-libc.
+char *FormatDecimal(float result) {
+  unsigned long bits = 0;  // Auf dem PC ist unsigned long 8 Byte breit
+  memcpy(&bits, &result, 4);
+  bool negative = (bits >> 31) != 0;
+  byte exponent = (bits >> 23) & 0xFF;
+  unsigned long mantissa = bits & 0x7FFFFFUL;
+  if (exponent >= FORMAT_MAX_EXPONENT) { return NULL; }  // Auch inf und nan
+  if (exponent != 0) { mantissa |= 0x800000UL; }         // Sonst subnormal
+  byte shift = exponent != 0 ? 150 - exponent : 149;     // Wert = Mantisse / 2^shift, shift >= 14
+
+  unsigned long scaled = 0;
+  if (shift < 40) {  // Darüber ist Mantisse * 10^4 < 2^38 kleiner als eine halbe Stelle
+    unsigned long long product = (unsigned long long)mantissa * 10000;
+    scaled = product >> shift;
+    if ((product >> (shift - 1)) & 1) { scaled++; }  // Rest >= 1/2
+  }
+  if (scaled >= FIXED_MAX_WHOLE) { return NULL; }  // 999.99996 -> 1000.0000: dtostrf
+  return FormatFixed(negative, scaled / 10000, scaled % 10000);
+}
+
+// Berechnet "a<op>b" an Ort und Stelle, liefert STATUS_OK oder einen Fehlercode.
+// input muss Platz für length + 1 Zeichen haben und wird verändert (Operator -> '\0').
+byte Calculate(char *input, byte length, float &result) {
   char operation;
-  double num1, num2;
-  double result;
+  float num1, num2;
   int operator_index = -1;
-  int string_len = input_string.length();  //Abfrage der Länge der Zeichenkette
+  input[length] = '\0';
   //Suche nach dem Index der Operation in der Zeichenfolge des arithmetischen Ausdrucks
-  for (int i = 1; i <= string_len; i++) {
-    operation = input_string[i];
+  //(ab Index 1, damit ein Vorzeichen der ersten Zahl nicht als Operator gilt)
+  for (byte i = 1; i < length; i++) {
+    operation = input[i];
     if ((operation == '+') || (operation == '-') || (operation == '*') || (operation == '/')) {
       operator_index = i;
       break;
     }
   }
-  //Wenn der Operator nicht gefunden wurde, wird eine Fehlermeldung angezeigt
-  if (operator_index == -1) { return "Error: operation not found"; }
+  if (operator_index == -1) { return ERR_NO_OPERATOR; }
+
+  //Die Ausdrücke trennen und die Zahlen umwandeln (ParseNumber wie atof)
+  input[operator_index] = '\0';
+  num1 = ParseNumber(input);
+  num2 = ParseNumber(input + operator_index + 1);
+
+  return Apply(operation, num1, num2, result);
+}
 
-  //Die Ausdrücke trennen und die Zahlen von String in Double umwandeln
-  String s_num1 = input_string.substring(0, operator_index);
-  String s_num2 = input_string.substring(operator_index + 1, string_len);
-  num1 = s_num1.toDouble();
-  num2 = s_num2.toDouble();
+// Binär: 9 Byte "a<op>b", die Operanden hat der PC schon umgewandelt
+byte CalculateF32(const byte *payload, byte length, float &result) {
+  if (length != 9) { return ERR_BAD_PAYLOAD; }
+  char operation = payload[4];
+  if (!IsOperator(operation)) { return ERR_BAD_PAYLOAD; }
+  float num1, num2;
+  memcpy(&num1, payload, 4);  // AVR und x86 sind beide little endian
+  memcpy(&num2, payload + 5, 4);
+  return Apply(operation, num1, num2, result);
+}
+
+// Mehrere Rechnungen in einem Rahmen. Die Antwort wird auf dem Stack gebaut (100 Byte);
+// fehlerhafte Rechnungen setzen ihr Bit in der Maske und tragen statt des floats den Fehlercode.
+void RunBatch(byte seq, const byte *payload, byte length) {
+  byte count = length > 0 ? payload[0] : 0;
+  char shared = length > 1 ? (char)payload[1] : 0;
+  byte elementSize = shared != 0 ? 8 : 9;
+  if (count == 0 || count > BATCH_MAX_COUNT || length != 2 + count * elementSize) {
+    SendError(seq, ERR_BAD_PAYLOAD);
+    return;
+  }
+
+  byte reply[1 + (BATCH_MAX_COUNT + 7) / 8 + BATCH_MAX_COUNT * 4];
+  byte maskBytes = (count + 7) / 8;
+  byte *results = reply + 1 + maskBytes;
+  reply[0] = count;
+  memset(reply + 1, 0, maskBytes);
+  const byte *element = payload + 2;
+  for (byte i = 0; i < count; i++) {
+    char operation = shared != 0 ? shared : (char)*element++;
+    float num1, num2;
+    memcpy(&num1, element, 4);
+    memcpy(&num2, element + 4, 4);
+    element += 8;
+
+    float result;
+    byte status = IsOperator(operation) ? Apply(operation, num1, num2, result) : ERR_BAD_PAYLOAD;
+    byte *slot = results + 4 * i;
+    if (status == STATUS_OK) {
+      memcpy(slot, &result, 4);
+    } else {
+      reply[1 + i / 8] |= 1 << (i % 8);
+      slot[0] = status;
+      slot[1] = slot[2] = slot[3] = 0;
+    }
+  }
+  SendFrame(seq, OP_RESULT_BATCH, reply, 1 + maskBytes + 4 * count);
+}
 
-  //Die eigentliche Berechnung durchführen
+bool IsOperator(char operation) {
+  return (operation == '+') || (operation == '-') || (operation == '*') || (operation == '/');
+}
+
+//Die eigentliche Berechnung durchführen
+byte Apply(char operation, float num1, float num2, float &result) {
   switch (operation) {
     case '+':
       result = num1 + num2;
@@ -60,12 +743,57 @@ String GetResult(String input_string) {
       result = num1 * num2;
       break;
     case '/':
-      if (num2 == 0) { return "Error: divison by 0"; }
+      if (num2 == 0) { return ERR_DIV_ZERO; }
       result = num1 / num2;
       break;
+    default:
+      return ERR_BAD_PAYLOAD;
   }
-  String s_result = String(result, 4);  //Long Double in String umwandeln mit 4 Nachkommastellen
-  return s_result;
+  return STATUS_OK;
 }
 
+// Führt Postfix-Bytecode aus. Der Stack liegt auf dem Stack der Funktion (64 Byte),
+// jeder Befehl kostet neben der eigentlichen Rechnung nur einen Sprung über switch.
+byte RunBytecode(const byte *code, byte length, float &result) {
+  float stack[VM_STACK_SIZE];
+  byte sp = 0;
+  byte pc = 0;
+  while (pc < length) {
+    byte op = code[pc++];
+    if (op == VM_PUSH_F32) {
+      if (sp >= VM_STACK_SIZE || pc + 4 > length) { return ERR_BAD_BYTECODE; }
+      memcpy(&stack[sp++], code + pc, 4);  // AVR und x86 sind beide little endian
+      pc += 4;
+    } else if (op == VM_PUSH_I8) {
+      if (sp >= VM_STACK_SIZE || pc + 1 > length) { return ERR_BAD_BYTECODE; }
+      stack[sp++] = (signed char)code[pc++];
+    } else if (op == VM_NEG) {
+      if (sp < 1) { return ERR_BAD_BYTECODE; }
+      stack[sp - 1] = -stack[sp - 1];
+    } else {
+      if (sp < 2) { return ERR_BAD_BYTECODE; }
+      float b = stack[--sp];
+      float &a = stack[sp - 1];
+      switch (op) {
+        case VM_ADD: a = a + b; break;
+        case VM_SUB: a = a - b; break;
+        case VM_MUL: a = a * b; break;
+        case VM_DIV:
+          if (b == 0) { return ERR_DIV_ZERO; }
+          a = a / b;
+          break;
+        default: return ERR_BAD_BYTECODE;
+      }
+    }
+  }
+  if (sp != 1) { return ERR_BAD_BYTECODE; }
+  result = stack[0];
+  return STATUS_OK;
+}
 
+// Wie String(result, 4): dtostrf mit Breite 6 und 4 Nachkommastellen, ohne Heap
+char *FormatResult(float result) {
+  char *fast = FormatDecimal(result);
+  if (fast != NULL) { return fast; }
+  return dtostrf(result, 6, 4, resultBuffer);
+}
@@ -0,0 +1,445 @@
+#include "Arduino.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <strings.h>
+#include <new>
+
+ShimStats shim;
+HardwareSerial Serial;
+
+// Kostenmodell in AVR-Zyklen, Richtwerte aus dem Zyklusbudget in arduino_main.ino.
+// Gezählt werden nur Aufrufe in die Arduino-API und avr-libc; der eigene Code des Sketches
+// (Zustandsautomat, CRC, Rechnung) ist nicht instrumentiert und zeigt sich in der Laufzeit.
+namespace Cost
+{
+    const unsigned long SerialAvailable = 10;
+    const unsigned long SerialRead = 40;
+    const unsigned long SerialWriteByte = 80;  // Ringpuffer + UDRE-Interrupt
+    const unsigned long Millis = 20;
+    const unsigned long AtofBase = 1000;
+    const unsigned long AtofPerChar = 150;
+    const unsigned long DtostrfBase = 2500;
+    const unsigned long DtostrfPerChar = 250;
+    const unsigned long Allocation = 300;      // malloc/realloc in avr-libc
+}
+
+// Puffer des Shims selbst (Serial-Warteschlangen) zählen nicht als Allokation des Sketches
+static int internalDepth = 0;
+
+struct ShimInternal
+{
+    ShimInternal() { internalDepth++; }
+    ~ShimInternal() { internalDepth--; }
+};
+
+static bool counting()
+{
+    return shim.tracking && internalDepth == 0;
+}
+
+void shimAddCycles(unsigned long cycles)
+{
+    shim.cycles += cycles;
+}
+
+void *shimAllocate(size_t size)
+{
+    if (counting())
+    {
+        shim.allocations++;
+        shim.bytesAllocated += size;
+        shimAddCycles(Cost::Allocation);
+    }
+    return malloc(size);
+}
+
+void *shimReallocate(void *pointer, size_t size)
+{
+    if (counting())
+    {
+        shim.allocations++;
+        shim.bytesAllocated += size;
+        shimAddCycles(Cost::Allocation);
+    }
+    return realloc(pointer, size);
+}
+
+void shimFree(void *pointer)
+{
+    if (pointer && counting())
+        shim.frees++;
+    free(pointer);
+}
+
+// Auch new/delete zählen, falls der Sketch sie benutzt
+void *operator new(size_t size)
+{
+    void *pointer = shimAllocate(size);
+    if (!pointer)
+        throw std::bad_alloc();
+    return pointer;
+}
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *pointer) noexcept { shimFree(pointer); }
+void operator delete[](void *pointer) noexcept { shimFree(pointer); }
+void operator delete(void *pointer, size_t) noexcept { shimFree(pointer); }
+void operator delete[](void *pointer, size_t) noexcept { shimFree(pointer); }
+
+unsigned long millis()
+{
+    shimAddCycles(Cost::Millis);
+    return static_cast<unsigned long>(shim.cycles / 16000);
+}
+
+unsigned long micros()
+{
+    shimAddCycles(Cost::Millis);
+    return static_cast<unsigned long>(shim.cycles / 16);
+}
+
+void delay(unsigned long ms)
+{
+    shimAddCycles(ms * 16000);
+}
+
+// Nachbau von dtostrf aus avr-libc (dtoa_prf mit __ftoa_engine) nach deren Quelltext, nicht
+// gegen ein Gerät geprüft: höchstens 7 signifikante Stellen, dahinter Nullen, genau halbe
+// Stellen von der Null weg; "nan"/"inf" klein, rechtsbündig auf width. Der Sketch übergibt
+// float, mal bzw. durch die Zehnerpotenz bleibt das in long double exakt, soweit es für die
+// Rundung darauf ankommt.
+char *dtostrf(double value, signed char width, unsigned char precision, char *buffer)
+{
+    char text[64];
+    char *out = text;
+    const float number = static_cast<float>(value);
+    if (std::isnan(number))
+    {
+        strcpy(out, "nan");
+    }
+    else
+    {
+        if (std::signbit(number))
+            *out++ = '-';
+        const long double magnitude = fabsl(number);
+        if (std::isinf(number))
+        {
+            strcpy(out, "inf");
+        }
+        else
+        {
+            // Behaltene Nachkommastellen: precision, aber nie mehr als 7 signifikante Stellen
+            const int exponent = magnitude > 0 ? static_cast<int>(floorl(log10l(magnitude))) : 0;
+            const int kept = std::min<int>(precision, 6 - exponent);
+            const long double scaled = kept >= 0 ? magnitude * powl(10.0L, kept) : magnitude / powl(10.0L, -kept);
+            unsigned long long digits = static_cast<unsigned long long>(floorl(scaled));
+            if (scaled - digits >= 0.5L)
+                digits++;
+
+            // Ganzzahliger Teil, dann die behaltenen Nachkommastellen, dann Nullen bis precision
+            unsigned long long unit = 1;
+            for (int i = 0; i < kept; i++)
+                unit *= 10;
+            out += sprintf(out, "%llu", kept >= 0 ? digits / unit : digits);
+            for (int i = kept; i < 0; i++)
+                *out++ = '0';
+            if (precision > 0)
+            {
+                *out++ = '.';
+                unsigned long long fraction = kept > 0 ? digits % unit : 0;
+                for (int i = kept - 1; i >= 0; i--, fraction /= 10)
+                    out[i] = static_cast<char>('0' + fraction % 10);
+                out += std::max(kept, 0);
+                for (int i = std::max(kept, 0); i < precision; i++)
+                    *out++ = '0';
+            }
+            *out = '\0';
+        }
+    }
+    // Rechtsbündig auf width, negativ linksbündig (wie "%*s", aber ohne Warnung unter -fsanitize)
+    const size_t length = strlen(text);
+    const size_t padding = static_cast<size_t>(std::max<int>(0, std::abs(width) - static_cast<int>(length)));
+    if (width < 0)
+    {
+        memcpy(buffer, text, length);
+        memset(buffer + length, ' ', padding);
+    }
+    else
+    {
+        memset(buffer, ' ', padding);
+        memcpy(buffer + padding, text, length);
+    }
+    buffer[length + padding] = '\0';
+    shimAddCycles(Cost::DtostrfBase + Cost::DtostrfPerChar * strlen(buffer));
+    return buffer;
+}
+
+// Nachbau von strtod aus avr-libc nach deren Quelltext (nicht gegen ein Gerät geprüft),
+// Ergebnis float: die Ziffern werden als 32-Bit-Ganzzahl
+// gesammelt (nach einem Überlauf zählen sie nur noch zum Exponenten), die Zahl in float
+// gewandelt und dann mit den float-Konstanten 10^±32, 10^±16 ... 10^±1 multipliziert.
+// Anders als strtof ist das nicht immer korrekt gerundet.
+double shimAtof(const char *text)
+{
+    static const float PowersUp[] = {1e1f, 1e2f, 1e4f, 1e8f, 1e16f, 1e32f};
+    static const float PowersDown[] = {1e-1f, 1e-2f, 1e-4f, 1e-8f, 1e-16f, 1e-32f};
+    const char *p = text;
+    while (isspace(static_cast<unsigned char>(*p)))
+        p++;
+    bool minus = false;
+    if (*p == '-' || *p == '+')
+        minus = *p++ == '-';
+
+    float value;
+    if (strncasecmp(p, "nan", 3) == 0)
+    {
+        value = NAN;
+        p += 3;
+    }
+    else if (strncasecmp(p, "inf", 3) == 0)
+    {
+        value = minus ? -INFINITY : INFINITY;
+        p += strncasecmp(p, "infinity", 8) == 0 ? 8 : 3;
+    }
+    else
+    {
+        uint32_t mantissa = 0;
+        int exponent = 0;
+        bool any = false;
+        bool dot = false;
+        bool overflow = false;
+        for (;; p++)
+        {
+            const unsigned char digit = static_cast<unsigned char>(*p - '0');
+            if (digit <= 9)
+            {
+                any = true;
+                if (overflow)
+                {
+                    if (!dot)
+                        exponent++;
+                }
+                else
+                {
+                    if (dot)
+                        exponent--;
+                    mantissa = mantissa * 10 + digit;
+                    if (mantissa >= (UINT32_MAX - 9) / 10)
+                        overflow = true;
+                }
+            }
+            else if (*p == '.' && !dot)
+            {
+                dot = true;
+            }
+            else
+            {
+                break;
+            }
+        }
+        if (any && (*p == 'e' || *p == 'E'))
+        {
+            const char *q = p + 1;
+            const bool negativeExponent = *q == '-';
+            if (*q == '-' || *q == '+')
+                q++;
+            if (*q >= '0' && *q <= '9')
+            {
+                int i = 0;
+                for (; *q >= '0' && *q <= '9'; q++)
+                {
+                    if (i < 3200)
+                        i = i * 10 + (*q - '0');
+                }
+                exponent += negativeExponent ? -i : i;
+                p = q;
+            }
+        }
+        if (!any)
+            p = text; // Keine Zahl: nichts verbraucht
+
+        value = static_cast<float>(mantissa);
+        if (minus && any)
+            value = -value;
+        if (value != 0)
+        {
+            const float *powers = exponent < 0 ? PowersDown : PowersUp;
+            int remaining = exponent < 0 ? -exponent : exponent;
+            for (int bit = 5; bit >= 0; bit--)
+            {
+                for (; remaining >= (1 << bit); remaining -= 1 << bit)
+                    value *= powers[bit];
+            }
+        }
+    }
+    shimAddCycles(Cost::AtofBase + Cost::AtofPerChar * (p - text));
+    return value;
+}
+
+String::String(const char *text)
+{
+    concat(text, strlen(text));
+}
+
+String::String(const String &other)
+{
+    concat(other.c_str(), other.len);
+}
+
+String::String(char c)
+{
+    concat(&c, 1);
+}
+
+String::String(int value)
+{
+    char text[12];
+    snprintf(text, sizeof(text), "%d", value);
+    concat(text, strlen(text));
+}
+
+String::String(double value, unsigned char decimals)
+{
+    char text[48];
+    dtostrf(value, decimals + 2, decimals, text);
+    concat(text, strlen(text));
+}
+
+String::~String()
+{
+    shimFree(buffer);
+}
+
+String &String::operator=(const String &other)
+{
+    if (this != &other)
+    {
+        len = 0;
+        concat(other.c_str(), other.len);
+    }
+    return *this;
+}
+
+String operator+(const String &a, const String &b)
+{
+    String result(a);
+    result += b;
+    return result;
+}
+
+bool String::reserve(unsigned int size)
+{
+    if (buffer && capacity >= size)
+        return true;
+    char *grown = static_cast<char *>(shimReallocate(buffer, size + 1));
+    if (!grown)
+        return false;
+    buffer = grown;
+    capacity = size;
+    return true;
+}
+
+String &String::concat(const char *text, unsigned int count)
+{
+    if (!reserve(len + count))
+        return *this;
+    memmove(buffer + len, text, count); // text kann im eigenen Puffer liegen
+    len += count;
+    buffer[len] = '\0';
+    return *this;
+}
+
+int String::indexOf(char c) const
+{
+    const char *found = len ? strchr(buffer, c) : nullptr;
+    return found ? static_cast<int>(found - buffer) : -1;
+}
+
+String String::substring(unsigned int from, unsigned int to) const
+{
+    if (from > to)
+    {
+        const unsigned int swap = from;
+        from = to;
+        to = swap;
+    }
+    if (from >= len)
+        return String();
+    if (to > len)
+        to = len;
+    String result;
+    result.concat(buffer + from, to - from);
+    return result;
+}
+
+void String::remove(unsigned int index)
+{
+    if (index < len)
+    {
+        len = index;
+        buffer[len] = '\0';
+    }
+}
+
+void String::trim()
+{
+    unsigned int start = 0;
+    while (start < len && (buffer[start] == ' ' || buffer[start] == '\t' || buffer[start] == '\r' || buffer[start] == '\n'))
+        start++;
+    unsigned int end = len;
+    while (end > start && (buffer[end - 1] == ' ' || buffer[end - 1] == '\t' || buffer[end - 1] == '\r' || buffer[end - 1] == '\n'))
+        end--;
+    if (start > 0)
+        memmove(buffer, buffer + start, end - start);
+    len = end - start;
+    if (buffer)
+        buffer[len] = '\0';
+}
+
+void HardwareSerial::begin(unsigned long baud)
+{
+    baudRate = baud;
+}
+
+int HardwareSerial::available()
+{
+    shimAddCycles(Cost::SerialAvailable);
+    return static_cast<int>(input.size());
+}
+
+int HardwareSerial::read()
+{
+    shimAddCycles(Cost::SerialRead);
+    ShimInternal internal;
+    if (input.empty())
+        return -1;
+    const int value = input.front();
+    input.pop_front();
+    return value;
+}
+
+size_t HardwareSerial::write(uint8_t value)
+{
+    shimAddCycles(Cost::SerialWriteByte);
+    ShimInternal internal;
+    output.push_back(value);
+    return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t *data, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+        write(data[i]);
+    return length;
+}
+
+size_t HardwareSerial::print(const char *text)
+{
+    return write(reinterpret_cast<const uint8_t *>(text), strlen(text));
+}
+
+size_t HardwareSerial::println(const char *text)
+{
+    const size_t count = print(text);
+    return count + print("\r\n");
+}
@@ -0,0 +1,109 @@
+// Minimaler Ersatz für die Arduino-API, damit arduino_main.ino unverändert auf dem PC
+// übersetzt werden kann (siehe arduino_host.pro). Zählt Heap-Allokationen und schätzt
+// die Zyklen, die der Sketch in Bibliotheksfunktionen und serieller E/A verbringt.
+#ifndef ARDUINO_SHIM_H
+#define ARDUINO_SHIM_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <deque>
+#include <vector>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+// Zähler des Shims, werden vom Testtreiber gelesen und zurückgesetzt
+struct ShimStats
+{
+    unsigned long long cycles = 0;      // Geschätzte AVR-Zyklen bei 16 MHz (Kostenmodell in Arduino.cpp)
+    unsigned long long allocations = 0; // new, new[] und String-Puffer
+    unsigned long long frees = 0;
+    unsigned long long bytesAllocated = 0;
+    bool tracking = false;              // Nur Allokationen zählen, während der Sketch läuft
+};
+extern ShimStats shim;
+
+void shimAddCycles(unsigned long cycles);
+void *shimAllocate(size_t size);             // Gezählt, für String
+void *shimReallocate(void *pointer, size_t size);
+void shimFree(void *pointer);
+
+unsigned long millis(); // Simulierte Zeit: shim.cycles / 16000
+unsigned long micros(); // Simulierte Zeit: shim.cycles / 16
+void delay(unsigned long ms);
+
+// avr-libc: double ist dort 32 Bit breit, beide runden auf float
+char *dtostrf(double value, signed char width, unsigned char precision, char *buffer);
+double shimAtof(const char *text);
+#define atof shimAtof // Nach <stdlib.h>, damit die Deklaration der libc unberührt bleibt
+
+// Arduino-String mit Heap-Puffer wie im Original (jede Änderung kann realloc auslösen)
+class String
+{
+public:
+    String(const char *text = "");
+    String(const String &other);
+    String(char c);
+    String(int value);
+    String(double value, unsigned char decimals = 2);
+    ~String();
+    String &operator=(const String &other);
+
+    unsigned int length() const { return len; }
+    const char *c_str() const { return buffer ? buffer : ""; }
+    char charAt(unsigned int index) const { return index < len ? buffer[index] : 0; }
+    char operator[](unsigned int index) const { return charAt(index); }
+    String &operator+=(const String &other) { return concat(other.c_str(), other.len); }
+    String &operator+=(const char *text) { return concat(text, strlen(text)); }
+    String &operator+=(char c) { return concat(&c, 1); }
+    friend String operator+(const String &a, const String &b);
+    bool operator==(const String &other) const { return strcmp(c_str(), other.c_str()) == 0; }
+    bool operator==(const char *text) const { return strcmp(c_str(), text) == 0; }
+    int indexOf(char c) const;
+    String substring(unsigned int from, unsigned int to) const;
+    String substring(unsigned int from) const { return substring(from, len); }
+    void remove(unsigned int index);
+    void trim();
+    double toDouble() const { return atof(c_str()); }
+    long toInt() const { return strtol(c_str(), nullptr, 10); }
+
+private:
+    String &concat(const char *text, unsigned int count);
+    bool reserve(unsigned int size);
+
+    char *buffer = nullptr;
+    unsigned int capacity = 0;
+    unsigned int len = 0;
+};
+
+// Serial mit Eingabe- und Ausgabepuffer, die der Testtreiber füllt bzw. leert
+class HardwareSerial
+{
+public:
+    void begin(unsigned long baud);
+    void end() {}
+    void flush() {}
+    int available();
+    int read();
+    int availableForWrite() { return 63; } // Der Treiber leert output sofort: Sendepuffer des Cores immer frei
+    size_t write(uint8_t value);
+    size_t write(const uint8_t *data, size_t length);
+    size_t print(const char *text);
+    size_t print(const String &text) { return print(text.c_str()); }
+    size_t println(const char *text);
+    size_t println(const String &text) { return println(text.c_str()); }
+    operator bool() const { return true; }
+
+    std::deque<uint8_t> input;  // Vom Treiber gefüllt
+    std::vector<uint8_t> output; // Vom Treiber geleert
+    unsigned long baudRate = 0;
+};
+extern HardwareSerial Serial;
+
+void setup();
+void loop();
+
+#endif // ARDUINO_SHIM_H
@@ -0,0 +1,19 @@
+# Sketch auf dem PC übersetzen: Profiling und Fuzzing ohne Hardware (siehe host_main.cpp)
+#
+#   qmake arduino_host.pro && make && ./sketch_host bench
+#   qmake CONFIG+=sanitize arduino_host.pro && make && ./sketch_host fuzz 1000000
+TEMPLATE = app
+CONFIG += console c++17 release
+CONFIG -= qt app_bundle
+TARGET = sketch_host
+
+SOURCES += Arduino.cpp \
+           sketch_host.cpp \
+           host_main.cpp
+HEADERS += Arduino.h
+DEPENDPATH += $$PWD/..  # arduino_main.ino wird in sketch_host.cpp eingebunden
+
+sanitize {
+    QMAKE_CXXFLAGS += -fsanitize=address,undefined -fno-omit-frame-pointer
+    QMAKE_LFLAGS += -fsanitize=address,undefined
+}
@@ -0,0 +1,418 @@
+// Testtreiber für den Sketch auf dem PC
+//
+//   sketch_host run                       stdin -> Serial -> stdout (z.B. für Mitschnitte)
+//   sketch_host bench [iterations]        Zyklen, Allokationen und Laufzeit pro Anfrage
+//   sketch_host fuzz [iterations] [seed]  Zufällige und beschädigte Eingaben, prüft die Ausgabe
+//   sketch_host exact [iterations] [seed] Festkomma-Abkürzung gegen den float-Weg
+//   sketch_host codec [iterations] [seed] ParseNumber/FormatDecimal bitgenau gegen atof/dtostrf des Shims
+//
+// exact und codec vergleichen mit dem Nachbau von atof/dtostrf in Arduino.cpp, nicht mit
+// avr-libc selbst: Weicht der Nachbau vom Gerät ab, fällt das hier nicht auf.
+#include "Arduino.h"
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <string>
+
+// Aus dem Sketch, der wie auf dem AVR in 32-Bit-float rechnet
+char *FastResult(const char *input, byte length);
+byte Calculate(char *input, byte length, float &result);
+char *FormatResult(float result);
+float ParseNumber(const char *text);
+char *FormatDecimal(float result);
+
+namespace
+{
+const unsigned long LoopCycles = 30; // Aufruf von loop() und Rückkehr in main() des Arduino-Cores
+const uint8_t Sync = 0xA5;
+const uint8_t MaxBatchPayload = 218; // FRAME_MAX_BATCH_PAYLOAD im Sketch
+const char NibbleChars[] = "0123456789.-+*/";
+
+uint8_t crc8(const std::vector<uint8_t> &data, size_t from)
+{
+    uint8_t crc = 0;
+    for (size_t i = from; i < data.size(); i++)
+    {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc & 0x80) ? static_cast<uint8_t>((crc << 1) ^ 0x07) : static_cast<uint8_t>(crc << 1);
+    }
+    return crc;
+}
+
+std::vector<uint8_t> frame(uint8_t seq, uint8_t opcode, const std::vector<uint8_t> &payload)
+{
+    std::vector<uint8_t> bytes;
+    bytes.reserve(payload.size() + 5);
+    bytes.push_back(Sync);
+    bytes.push_back(static_cast<uint8_t>(payload.size()));
+    bytes.push_back(seq);
+    bytes.push_back(opcode);
+    bytes.insert(bytes.end(), payload.begin(), payload.end());
+    bytes.push_back(crc8(bytes, 1));
+    return bytes;
+}
+
+std::vector<uint8_t> pack(const std::string &text)
+{
+    std::vector<uint8_t> packed;
+    for (size_t i = 0; i < text.size(); i++)
+    {
+        const uint8_t nibble = static_cast<uint8_t>(strchr(NibbleChars, text[i]) - NibbleChars);
+        if (i % 2 == 0)
+            packed.push_back(static_cast<uint8_t>(nibble << 4 | 0x0F));
+        else
+            packed.back() = static_cast<uint8_t>((packed.back() & 0xF0) | nibble);
+    }
+    return packed;
+}
+
+std::vector<uint8_t> text(const std::string &line)
+{
+    return std::vector<uint8_t>(line.begin(), line.end());
+}
+
+// Eingabe übergeben und loop() laufen lassen, bis alles gelesen und beantwortet ist
+// (die letzte Nachricht wird erst nach dem Empfang ausgewertet und gesendet)
+void feed(const std::vector<uint8_t> &input)
+{
+    Serial.input.insert(Serial.input.end(), input.begin(), input.end());
+    shim.tracking = true;
+    size_t sent;
+    do
+    {
+        sent = Serial.output.size();
+        shimAddCycles(LoopCycles);
+        loop();
+    } while (!Serial.input.empty() || Serial.output.size() != sent);
+    shim.tracking = false;
+}
+
+int run()
+{
+    std::vector<uint8_t> input;
+    int c;
+    while ((c = getchar()) != EOF)
+        input.push_back(static_cast<uint8_t>(c));
+    feed(input);
+    fwrite(Serial.output.data(), 1, Serial.output.size(), stdout);
+    fprintf(stderr, "%llu cycles, %llu allocations\n", shim.cycles, shim.allocations);
+    return 0;
+}
+
+int bench(long iterations)
+{
+    struct Case
+    {
+        const char *name;
+        std::vector<uint8_t> input;
+    };
+    // (1.5+2)*-3 als Bytecode: PUSH_F32 1.5, PUSH_I8 2, ADD, PUSH_I8 -3, MUL
+    const std::vector<uint8_t> bytecode = {0x01, 0x00, 0x00, 0xC0, 0x3F, 0x02, 0x02, 0x10, 0x02, 0xFD, 0x12};
+    // 12.5 + 3.25 als zwei floats (little endian) und Operator
+    const std::vector<uint8_t> calcF32 = {0x00, 0x00, 0x48, 0x41, '+', 0x00, 0x00, 0x50, 0x40};
+    // 24 mal 12.5 + 3.25 mit gemeinsamem Operator; cycles/op gilt hier für den ganzen Rahmen
+    std::vector<uint8_t> batch = {24, '+'};
+    for (int i = 0; i < 24; i++)
+        batch.insert(batch.end(), {0x00, 0x00, 0x48, 0x41, 0x00, 0x00, 0x50, 0x40});
+    const Case cases[] = {
+        {"text a+b", text("12.5+3.25\n")},
+        {"text a*b", text("12.375*3.14159\n")},
+        {"text a/0", text("7/0\n")},
+        {"frame calc", frame(1, 0x01, pack("12.5+3.25"))},
+        {"frame exec", frame(1, 0x06, bytecode)},
+        {"frame f32", frame(1, 0x07, calcF32)},
+        {"frame exec32", frame(1, 0x08, bytecode)},
+        {"frame batch24", frame(1, 0x09, batch)},
+        {"frame ping", frame(1, 0x02, {})},
+    };
+
+    printf("%-12s %12s %12s %12s %10s\n", "case", "cycles/op", "allocs/op", "host_ns/op", "out_bytes");
+    for (const Case &test : cases)
+    {
+        Serial.output.reserve(4096);
+        shim = ShimStats();
+        size_t outputBytes = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (long i = 0; i < iterations; i++)
+        {
+            feed(test.input);
+            outputBytes += Serial.output.size();
+            Serial.output.clear();
+        }
+        const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        printf("%-12s %12.0f %12.3f %12.0f %10.1f\n", test.name, static_cast<double>(shim.cycles) / iterations,
+               static_cast<double>(shim.allocations) / iterations, ns / iterations, static_cast<double>(outputBytes) / iterations);
+    }
+    return 0;
+}
+
+// Ausgabe muss aus vollständigen Rahmen mit gültiger CRC oder druckbaren Zeilen bestehen
+bool outputWellFormed(const std::vector<uint8_t> &output, std::string &problem)
+{
+    size_t i = 0;
+    while (i < output.size())
+    {
+        if (output[i] == Sync)
+        {
+            if (i + 5 > output.size() || output[i + 1] > MaxBatchPayload || i + 5 + output[i + 1] > output.size())
+            {
+                problem = "truncated frame";
+                return false;
+            }
+            const size_t end = i + 4 + output[i + 1];
+            const std::vector<uint8_t> body(output.begin() + i, output.begin() + end);
+            if (crc8(body, 1) != output[end])
+            {
+                problem = "bad frame crc";
+                return false;
+            }
+            i = end + 1;
+            continue;
+        }
+        while (i < output.size() && output[i] != '\n')
+        {
+            if (output[i] != '\r' && (output[i] < 0x20 || output[i] > 0x7E))
+            {
+                problem = "unprintable text";
+                return false;
+            }
+            i++;
+        }
+        if (i >= output.size())
+        {
+            problem = "unterminated line";
+            return false;
+        }
+        i++;
+    }
+    return true;
+}
+
+int fuzz(long iterations, unsigned seed)
+{
+    std::mt19937 random(seed);
+    auto pick = [&random](int n) { return static_cast<int>(random() % n); };
+    const char alphabet[] = "0123456789.-+*/ ,e";
+    const std::vector<uint8_t> opcodes = {0x01, 0x02, 0x03, 0x05, 0x06, 0x07, 0x08, 0x09, 0x7F};
+    long failures = 0;
+
+    for (long n = 0; n < iterations; n++)
+    {
+        std::vector<uint8_t> input;
+        switch (pick(4))
+        {
+        case 0: // Rauschen
+            for (int i = pick(80); i > 0; i--)
+                input.push_back(static_cast<uint8_t>(random()));
+            break;
+        case 1: // Textzeile aus dem Zeichenvorrat der Eingabe, auch überlang
+            for (int i = pick(100); i > 0; i--)
+                input.push_back(static_cast<uint8_t>(alphabet[pick(sizeof(alphabet) - 1)]));
+            input.push_back('\n');
+            break;
+        default: // Rahmen, teilweise beschädigt
+        {
+            const uint8_t opcode = opcodes[pick(opcodes.size())];
+            std::vector<uint8_t> payload;
+            for (int i = pick(opcode == 0x09 ? MaxBatchPayload + 1 : 49); i > 0; i--)
+                payload.push_back(static_cast<uint8_t>(random()));
+            if (opcode == 0x09 && payload.size() >= 2 && pick(2) == 0) // Stimmige Anzahl, Operatoren zufällig
+            {
+                payload[0] = static_cast<uint8_t>(1 + pick(24));
+                payload.resize(2 + payload[0] * (payload[1] != 0 ? 8 : 9));
+            }
+            input = frame(static_cast<uint8_t>(random()), opcode, payload);
+            if (pick(3) == 0)
+                input[pick(input.size())] ^= static_cast<uint8_t>(1 << pick(8));
+            if (pick(4) == 0)
+                input.resize(pick(input.size()));
+            break;
+        }
+        }
+
+        feed(input);
+        if (pick(8) == 0)
+            delay(pick(120)); // Rahmen-Timeout und Baudraten-Probezeit auslösen
+        feed({});
+
+        std::string problem;
+        if (shim.allocations != 0)
+            problem = "heap allocation";
+        else
+            outputWellFormed(Serial.output, problem);
+        if (!problem.empty())
+        {
+            failures++;
+            fprintf(stderr, "iteration %ld: %s\n", n, problem.c_str());
+            shim.allocations = 0;
+        }
+        Serial.output.clear();
+    }
+    printf("%ld iterations, seed %u, %ld failures, %llu cycles\n", iterations, seed, failures, shim.cycles);
+    return failures == 0 ? 0 : 1;
+}
+
+// Jeder Ausdruck, den FastResult annimmt, muss genau wie atof + Rechnung + dtostrf aussehen.
+// Operanden liegen absichtlich auch knapp über den Grenzen (2^24, 64, 5 Nachkommastellen).
+int exact(long iterations, unsigned seed)
+{
+    std::mt19937 random(seed);
+    auto pick = [&random](int n) { return static_cast<int>(random() % n); };
+    auto digits = [&](int count) {
+        std::string text;
+        for (int i = 0; i < count; i++)
+            text += static_cast<char>('0' + pick(10));
+        return text;
+    };
+    auto operand = [&]() {
+        std::string text = pick(4) == 0 ? "-" : (pick(16) == 0 ? "+" : "");
+        switch (pick(3))
+        {
+        case 0: // Ganze Zahl, auch über 2^24
+            text += digits(1 + pick(9));
+            break;
+        case 1: // Dezimalzahl um die Grenze 64
+            text += std::to_string(pick(140)) + "." + digits(1 + pick(5));
+            break;
+        default: // Kleine Werte und Null
+            text += digits(1 + pick(2)) + (pick(2) == 0 ? "." + digits(pick(5)) : "");
+            break;
+        }
+        return text;
+    };
+    const char operators[] = "+-*/";
+    long failures = 0;
+    long taken = 0;
+
+    for (long n = 0; n < iterations; n++)
+    {
+        std::string text = operand() + operators[pick(4)] + operand();
+        char input[64];
+        memcpy(input, text.c_str(), text.size() + 1);
+        const char *fast = FastResult(input, static_cast<byte>(text.size()));
+        if (fast == nullptr)
+            continue;
+        taken++;
+        const std::string fastText = fast;
+        float result;
+        const byte status = Calculate(input, static_cast<byte>(text.size()), result);
+        const std::string slowText = status == 0 ? FormatResult(result) : "error";
+        if (fastText != slowText)
+        {
+            failures++;
+            fprintf(stderr, "%s: fast %s, float %s\n", text.c_str(), fastText.c_str(), slowText.c_str());
+        }
+    }
+    printf("%ld iterations, seed %u, %ld fast, %ld mismatches\n", iterations, seed, taken, failures);
+    return failures == 0 ? 0 : 1;
+}
+
+// Zahlentexte gegen atof des Shims (Bitmuster) und floats gegen dessen dtostrf(value, 6, 4)
+// (Text), dazu die Laufzeit je Aufruf auf dem PC. Die Zyklen des AVR schätzt der Kommentar im Sketch.
+int codec(long iterations, unsigned seed)
+{
+    std::mt19937 random(seed);
+    auto pick = [&random](int n) { return static_cast<int>(random() % n); };
+    auto digits = [&](int count) {
+        std::string text;
+        for (int i = 0; i < count; i++)
+            text += static_cast<char>('0' + pick(10));
+        return text;
+    };
+    const char *odd[] = {" 5", "1e3", "2.5E-2", "inf", "-nan", ".", "-", "+.5", "5.", "1,5", "0x10"};
+    std::vector<std::string> texts;
+    std::vector<float> values;
+    for (long n = 0; n < iterations; n++)
+    {
+        std::string text = pick(3) == 0 ? "-" : (pick(16) == 0 ? "+" : "");
+        text += digits(pick(10));
+        if (pick(3) != 0)
+            text += "." + digits(pick(13));
+        texts.push_back(pick(64) == 0 ? std::string(odd[pick(sizeof(odd) / sizeof(odd[0]))]) : text);
+
+        float value;
+        switch (pick(4))
+        {
+        case 0: // Beliebiges Bitmuster
+        {
+            const uint32_t bits = static_cast<uint32_t>(random());
+            memcpy(&value, &bits, 4);
+            break;
+        }
+        case 1: // Genau halbe vierte Nachkommastelle: ungerade Vielfache von 1/32
+            value = static_cast<float>(2 * pick(64000) + 1) / 32 * (pick(2) == 0 ? 1 : -1);
+            break;
+        default: // Ergebnisse, wie sie der Sketch formatiert
+            value = shimAtof(text.c_str());
+            break;
+        }
+        values.push_back(value);
+    }
+
+    long failures = 0;
+    for (const std::string &text : texts)
+    {
+        const float fast = ParseNumber(text.c_str());
+        const float slow = shimAtof(text.c_str());
+        if (memcmp(&fast, &slow, 4) != 0 && !(std::isnan(fast) && std::isnan(slow)))
+        {
+            failures++;
+            fprintf(stderr, "parse %s: %.9g, atof %.9g\n", text.c_str(), fast, slow);
+        }
+    }
+    long formatted = 0;
+    for (float value : values)
+    {
+        const char *fast = FormatDecimal(value);
+        if (fast == nullptr)
+            continue;
+        formatted++;
+        const std::string fastText = fast;
+        char slow[48];
+        dtostrf(value, 6, 4, slow);
+        if (fastText != slow)
+        {
+            failures++;
+            fprintf(stderr, "format %.9g: %s, dtostrf %s\n", value, fastText.c_str(), slow);
+        }
+    }
+
+    auto timed = [](auto &&call) {
+        const auto start = std::chrono::steady_clock::now();
+        call();
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    };
+    volatile float sink = 0;
+    const double parseNs = timed([&]() { for (const std::string &text : texts) sink = sink + ParseNumber(text.c_str()); });
+    const double atofNs = timed([&]() { for (const std::string &text : texts) sink = sink + shimAtof(text.c_str()); });
+    const double formatNs = timed([&]() { for (float value : values) FormatResult(value); });
+    char buffer[48];
+    const double dtostrfNs = timed([&]() { for (float value : values) dtostrf(value, 6, 4, buffer); });
+
+    printf("%ld iterations, seed %u, %ld formatted without dtostrf, %ld mismatches\n", iterations, seed, formatted, failures);
+    printf("ns/call: ParseNumber %.1f, atof %.1f, FormatResult %.1f, dtostrf %.1f\n", parseNs / iterations,
+           atofNs / iterations, formatNs / iterations, dtostrfNs / iterations);
+    return failures == 0 ? 0 : 1;
+}
+}
+
+int main(int argc, char *argv[])
+{
+    setup();
+    const std::string mode = argc > 1 ? argv[1] : "run";
+    if (mode == "run")
+        return run();
+    if (mode == "bench")
+        return bench(argc > 2 ? atol(argv[2]) : 100000);
+    if (mode == "fuzz")
+        return fuzz(argc > 2 ? atol(argv[2]) : 100000, argc > 3 ? static_cast<unsigned>(atol(argv[3])) : 1);
+    if (mode == "exact")
+        return exact(argc > 2 ? atol(argv[2]) : 100000, argc > 3 ? static_cast<unsigned>(atol(argv[3])) : 1);
+    if (mode == "codec")
+        return codec(argc > 2 ? atol(argv[2]) : 100000, argc > 3 ? static_cast<unsigned>(atol(argv[3])) : 1);
+    fprintf(stderr, "usage: %s run | bench [iterations] | fuzz [iterations] [seed] | exact [iterations] [seed] | codec [iterations] [seed]\n"
+                    "exact and codec compare against the shim's atof/dtostrf, not against avr-libc on a device\n",
+            argv[0]);
+    return 2;
+}
@@ -0,0 +1,4 @@
+// Übersetzt arduino_main.ino unverändert gegen den Shim in Arduino.h
+#include "Arduino.h"
+
+#include "../arduino_main.ino"
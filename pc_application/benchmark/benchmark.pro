@@ -0,0 +1,30 @@
+QT += core serialport
+QT -= gui
+
+CONFIG += c++17 release console
+CONFIG -= app_bundle
+TARGET = Calculator_Benchmark
+# Pseudo-Terminals und eventfd: nur Linux
+!linux: error("The benchmark needs Linux pseudo terminals.")
+
+INCLUDEPATH += $$PWD/../src
+SOURCES += main.cpp \
+           deviceemulator.cpp \
+           benchmarkrunner.cpp \
+           ../src/requestengine.cpp \
+           ../src/protocol.cpp \
+           ../src/expression.cpp \
+           ../src/expressioncompiler.cpp \
+           ../src/hostevaluator.cpp \
+           ../src/latencystats.cpp \
+           ../src/linknegotiator.cpp
+
+HEADERS += deviceemulator.h \
+           benchmarkrunner.h \
+           ../src/requestengine.h \
+           ../src/protocol.h \
+           ../src/expression.h \
+           ../src/expressioncompiler.h \
+           ../src/hostevaluator.h \
+           ../src/latencystats.h \
+           ../src/linknegotiator.h
@@ -0,0 +1,158 @@
+#include "benchmarkrunner.h"
+#include <QCoreApplication>
+#include <cstdio>
+
+BenchmarkRunner::BenchmarkRunner(const Options &options, DeviceEmulator *emulator, QObject *parent)
+    : QObject(parent), options(options), emulator(emulator), serial(new QSerialPort(this)),
+      engine(new RequestEngine(serial, this)), negotiator(new LinkNegotiator(serial, engine, this))
+{
+    engine->setCacheSize(0);                                  // Jede Anfrage soll über die Leitung gehen
+    engine->setOffloadPolicy(RequestEngine::DeviceOnly);
+    engine->setTimeout(5000);
+
+    connect(engine, &RequestEngine::responseReceived, this, &BenchmarkRunner::handleResponse);
+    connect(engine, &RequestEngine::requestFailed, this, &BenchmarkRunner::handleFailed);
+    connect(engine, &RequestEngine::requestTimed, this, [this](quint32, const StageTimes &times) { stats.record(times); });
+    connect(negotiator, &LinkNegotiator::finished, this, &BenchmarkRunner::handleLinkReady);
+}
+
+QString BenchmarkRunner::workloadName(Workload workload)
+{
+    switch (workload)
+    {
+    case Single:
+        return "single";
+    case Pipelined:
+        return "pipelined";
+    case Batch:
+        return "batch";
+    default:
+        return QString();
+    }
+}
+
+void BenchmarkRunner::start()
+{
+    serial->setPortName(emulator->slavePath());
+    serial->setBaudRate(options.framed ? Protocol::DefaultBaudRate : options.maxBaudRate);
+    serial->setDataBits(QSerialPort::Data8);
+    serial->setParity(QSerialPort::NoParity);
+    serial->setStopBits(QSerialPort::OneStop);
+    serial->setFlowControl(QSerialPort::NoFlowControl);
+    if (!serial->open(QIODevice::ReadWrite))
+    {
+        fprintf(stderr, "Error: Could not open %s: %s\n", qPrintable(emulator->slavePath()), qPrintable(serial->errorString()));
+        QCoreApplication::exit(2);
+        return;
+    }
+
+    if (options.framed)
+    {
+        negotiator->setMaxBaudRate(options.maxBaudRate);
+        negotiator->start();
+    }
+    else
+    {
+        engine->setWireMode(RequestEngine::TextLines); // Wie nach einem fehlgeschlagenen Handshake
+        handleLinkReady(false, serial->baudRate());
+    }
+}
+
+void BenchmarkRunner::handleLinkReady(bool framed, qint32 baudRate)
+{
+    const Protocol::DeviceInfo &info = negotiator->deviceInfo();
+    engine->setDeviceFeatures(framed ? info.features : 0);
+    engine->setBinaryFloats(options.binaryFloats);
+    engine->setMaxBatchSize(options.batchSize);
+    vm = framed && info.has(Protocol::FeatureVm);
+    printf("Link: %s at %d baud%s%s\n", framed ? "framed protocol" : "text protocol", baudRate,
+           framed && options.binaryFloats && info.has(Protocol::FeatureF32) ? ", binary floats" : "",
+           engine->batchCapacity() > 1 ? qPrintable(QString(", batches of up to %1").arg(engine->batchCapacity())) : "");
+    printf("%-10s %8s %10s %10s %8s %8s %8s %8s %8s %7s\n",
+           "workload", "ops", "ops/s", "bytes/s", "p50_us", "p90_us", "p99_us", "p999_us", "max_us", "errors");
+    beginWorkload();
+}
+
+void BenchmarkRunner::beginWorkload()
+{
+    if (workloadIndex >= options.workloads.size())
+    {
+        serial->close();
+        QCoreApplication::exit(totalFailures > 0 ? 1 : 0);
+        return;
+    }
+
+    const Workload workload = options.workloads[workloadIndex];
+    engine->setMaxInFlight(workload == Single ? 1 : options.window);
+    backlog = workload == Single ? 1 : workload == Pipelined ? options.window : 256;
+    sent = completed = failures = 0;
+    stats.clear();
+    bytesAtStart = emulator->bytesReceived() + emulator->bytesSent();
+    clock.start();
+    fill();
+}
+
+void BenchmarkRunner::fill()
+{
+    while (sent < options.requests && engine->pendingCount() < backlog)
+    {
+        engine->enqueue(nextExpression());
+        sent++;
+    }
+}
+
+// Zufällige Operanden mit zwei Nachkommastellen, Divisor nie 0. Im Batch-Profil
+// ist jeder vierte Ausdruck zusammengesetzt und läuft (falls vorhanden) über die VM.
+QString BenchmarkRunner::nextExpression()
+{
+    static const char operators[] = {'+', '-', '*', '/'};
+    auto operand = [this]() { return QString::number(random.bounded(1, 100000) / 100.0, 'f', 2); };
+
+    if (options.workloads[workloadIndex] == Batch && vm && random.bounded(4) == 0)
+        return "(" + operand() + "+" + operand() + ")*" + operand() + "-" + operand() + "/" + operand();
+    return operand() + operators[random.bounded(4)] + operand();
+}
+
+void BenchmarkRunner::handleResponse(quint32 id, const QString &expression, const QString &response)
+{
+    Q_UNUSED(id);
+    Q_UNUSED(expression);
+    completeOne(!response.startsWith("Error"));
+}
+
+void BenchmarkRunner::handleFailed(quint32 id, const QString &expression, const QString &reason)
+{
+    Q_UNUSED(id);
+    fprintf(stderr, "Failed: %s: %s\n", qPrintable(expression), qPrintable(reason));
+    completeOne(false);
+}
+
+void BenchmarkRunner::completeOne(bool ok)
+{
+    completed++;
+    if (!ok)
+        failures++;
+    if (completed < options.requests)
+    {
+        fill();
+        return;
+    }
+    report();
+    workloadIndex++;
+    QMetaObject::invokeMethod(this, &BenchmarkRunner::beginWorkload, Qt::QueuedConnection);
+}
+
+void BenchmarkRunner::report()
+{
+    const double seconds = clock.nsecsElapsed() / 1e9;
+    const quint64 bytes = emulator->bytesReceived() + emulator->bytesSent() - bytesAtStart;
+    const LatencyHistogram &total = stats.histogram(LatencyStats::Total);
+    printf("%-10s %8d %10.1f %10.1f %8lld %8lld %8lld %8lld %8lld %7d\n",
+           qPrintable(workloadName(options.workloads[workloadIndex])), completed,
+           seconds > 0 ? completed / seconds : 0.0, seconds > 0 ? bytes / seconds : 0.0,
+           static_cast<long long>(total.percentile(50)), static_cast<long long>(total.percentile(90)),
+           static_cast<long long>(total.percentile(99)), static_cast<long long>(total.percentile(99.9)),
+           static_cast<long long>(total.max()), failures);
+    fflush(stdout);
+    totalFailures += failures;
+}
@@ -0,0 +1,76 @@
+#ifndef BENCHMARKRUNNER_H
+#define BENCHMARKRUNNER_H
+
+#include <QObject>
+#include <QSerialPort>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include "requestengine.h"
+#include "linknegotiator.h"
+#include "latencystats.h"
+#include "deviceemulator.h"
+
+// Treibt den Emulator über denselben Weg wie das MainWindow (QSerialPort, LinkNegotiator,
+// RequestEngine) und misst nacheinander mehrere Lastprofile
+class BenchmarkRunner : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Workload
+    {
+        Single,    // Fenster 1: eine Anfrage nach der anderen
+        Pipelined, // Volles Fenster mit einfachen Ausdrücken
+        Batch,     // Großer Rückstau, gemischte Ausdrücke wie im Batch-Modus
+        WorkloadCount
+    };
+
+    struct Options
+    {
+        bool framed = true;       // false: Textprotokoll wie bei alter Firmware
+        qint32 maxBaudRate = 115200;
+        int requests = 1000;      // Anfragen pro Lastprofile
+        int window = 4;           // Fenster für Pipelined und Batch
+        bool binaryFloats = false; // Zahlen als float statt als gepackter Text (FeatureF32)
+        int batchSize = Protocol::MaxBatchCount; // Rechnungen pro OpCalcBatch, 1: ohne Bündelung
+        QList<Workload> workloads;
+    };
+
+    BenchmarkRunner(const Options &options, DeviceEmulator *emulator, QObject *parent = nullptr);
+
+    static QString workloadName(Workload workload);
+
+public slots:
+    void start(); // Port öffnen, aushandeln und alle Lastprofile nacheinander ausführen
+
+private slots:
+    void handleResponse(quint32 id, const QString &expression, const QString &response);
+    void handleFailed(quint32 id, const QString &expression, const QString &reason);
+    void handleLinkReady(bool framed, qint32 baudRate); // Nach dem Handshake: Kopfzeile und erstes Lastprofil
+
+private:
+    void beginWorkload();
+    void fill();        // Anfragen nachlegen, bis der Rückstau des Lastprofils erreicht ist
+    void completeOne(bool ok);
+    void report();
+    QString nextExpression();
+
+    Options options;
+    DeviceEmulator *emulator;
+    QSerialPort *serial;
+    RequestEngine *engine;
+    LinkNegotiator *negotiator;
+    LatencyStats stats;
+    QElapsedTimer clock;
+    QRandomGenerator random{42}; // Gleiche Ausdrücke bei jedem Lauf
+    int workloadIndex = 0;
+    int sent = 0;
+    int completed = 0;
+    int failures = 0;
+    int totalFailures = 0;
+    int backlog = 1;
+    bool vm = false;             // Gerät kann Bytecode ausführen
+    quint64 bytesAtStart = 0;
+};
+
+#endif // BENCHMARKRUNNER_H
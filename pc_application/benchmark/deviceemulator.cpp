@@ -0,0 +1,407 @@
+#include "deviceemulator.h"
+#include "hostevaluator.h"
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <termios.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+    constexpr quint8 ProtocolVersion = 1;
+    constexpr quint16 Features = Protocol::FeatureFramed | Protocol::FeaturePing | Protocol::FeatureBaudRate | Protocol::FeatureVm
+                                 | Protocol::FeatureF32 | Protocol::FeatureBatch;
+    constexpr quint8 BaudMask = 0x1F;
+
+    // Wie Apply() im Sketch, liefert 0 oder einen Fehlercode
+    quint8 applyF32(char op, float num1, float num2, float &result)
+    {
+        if (op != '+' && op != '-' && op != '*' && op != '/')
+            return Protocol::ErrBadPayload;
+        if (op == '/' && num2 == 0)
+            return Protocol::ErrDivByZero;
+        result = op == '+' ? num1 + num2 : op == '-' ? num1 - num2 : op == '*' ? num1 * num2 : num1 / num2;
+        return 0;
+    }
+}
+
+DeviceEmulator::DeviceEmulator(const Config &config)
+    : config(config), baudRate(config.baudRate)
+{
+}
+
+DeviceEmulator::~DeviceEmulator()
+{
+    stop();
+}
+
+bool DeviceEmulator::start()
+{
+    masterFd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (masterFd < 0 || grantpt(masterFd) != 0 || unlockpt(masterFd) != 0)
+    {
+        error = QString("Could not create pseudo terminal: %1").arg(strerror(errno));
+        return false;
+    }
+    slaveName = QString::fromLocal8Bit(ptsname(masterFd));
+
+    // Rohdaten ohne Echo, bevor die Anwendung den Port öffnet
+    slaveFd = open(ptsname(masterFd), O_RDWR | O_NOCTTY);
+    if (slaveFd < 0)
+    {
+        error = QString("Could not open %1: %2").arg(slaveName, strerror(errno));
+        return false;
+    }
+    termios tio;
+    tcgetattr(slaveFd, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slaveFd, TCSANOW, &tio);
+
+    wakeFd = eventfd(0, EFD_NONBLOCK);
+    if (wakeFd < 0)
+    {
+        error = QString("Could not create eventfd: %1").arg(strerror(errno));
+        return false;
+    }
+
+    running = true;
+    ioThread = std::thread(&DeviceEmulator::ioLoop, this);
+    cpuThread = std::thread(&DeviceEmulator::cpuLoop, this);
+    return true;
+}
+
+void DeviceEmulator::stop()
+{
+    if (running.exchange(false))
+    {
+        rxReady.notify_all();
+        ioThread.join();
+        cpuThread.join();
+    }
+    if (slaveFd >= 0)
+        close(slaveFd);
+    if (masterFd >= 0)
+        close(masterFd);
+    if (wakeFd >= 0)
+        close(wakeFd);
+    slaveFd = masterFd = wakeFd = -1;
+}
+
+QString DeviceEmulator::slavePath() const
+{
+    return slaveName;
+}
+
+QString DeviceEmulator::errorString() const
+{
+    return error;
+}
+
+// 1 Startbit, 8 Datenbits, 1 Stoppbit
+DeviceEmulator::Clock::duration DeviceEmulator::byteTime() const
+{
+    return std::chrono::nanoseconds(10LL * 1000000000LL / baudRate.load());
+}
+
+// Empfang und Senden in einem Thread: ppoll wartet bis zum nächsten fälligen Sendebyte
+void DeviceEmulator::ioLoop()
+{
+    Clock::time_point lastArrival = Clock::now();
+    Clock::time_point txFree = Clock::now(); // Sendeleitung frei ab
+    char buffer[256];
+
+    while (running)
+    {
+        Clock::duration wait = std::chrono::milliseconds(20);
+        bool txPending;
+        {
+            std::lock_guard<std::mutex> lock(txMutex);
+            txPending = !txQueue.isEmpty();
+        }
+        if (txPending)
+        {
+            const Clock::time_point now = Clock::now();
+            txFree = std::max(txFree, now - byteTime()); // Leitung war frei: nicht nachholen
+            wait = std::max(Clock::duration::zero(), txFree + byteTime() - now);
+        }
+
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(wait).count();
+        timespec timeout = {static_cast<time_t>(ns / 1000000000), static_cast<long>(ns % 1000000000)};
+        pollfd fds[2] = {{masterFd, POLLIN, 0}, {wakeFd, POLLIN, 0}};
+        const int ready = ppoll(fds, 2, &timeout, nullptr);
+        if (ready > 0 && (fds[1].revents & POLLIN))
+        {
+            eventfd_t value;
+            eventfd_read(wakeFd, &value);
+        }
+
+        if (ready > 0 && (fds[0].revents & POLLIN))
+        {
+            const ssize_t count = read(masterFd, buffer, sizeof(buffer));
+            const Clock::time_point now = Clock::now();
+            if (count > 0)
+            {
+                std::lock_guard<std::mutex> lock(rxMutex);
+                for (ssize_t i = 0; i < count; i++)
+                {
+                    // Der PC schreibt sofort, die Leitung liefert ein Byte pro Bytezeit
+                    lastArrival = std::max(lastArrival + byteTime(), now);
+                    rxQueue.push_back({static_cast<quint8>(buffer[i]), lastArrival});
+                }
+                rxBytes += count;
+                rxReady.notify_one();
+            }
+        }
+
+        // Alle Bytes senden, deren Zeitpunkt erreicht ist
+        const Clock::time_point now = Clock::now();
+        std::lock_guard<std::mutex> lock(txMutex);
+        int due = 0;
+        while (due < txQueue.size() && txFree + byteTime() <= now)
+        {
+            txFree += byteTime();
+            due++;
+        }
+        if (due > 0)
+        {
+            const ssize_t written = write(masterFd, txQueue.constData(), due);
+            if (written > 0)
+            {
+                txQueue.remove(0, written);
+                txBytes += written;
+            }
+        }
+    }
+}
+
+// CPU des Arduino: eine Nachricht nach der anderen, frühestens wenn ihr letztes Byte angekommen ist
+void DeviceEmulator::cpuLoop()
+{
+    while (running)
+    {
+        RxByte byte;
+        {
+            std::unique_lock<std::mutex> lock(rxMutex);
+            rxReady.wait(lock, [this]() { return !rxQueue.empty() || !running; });
+            if (!running)
+                return;
+            byte = rxQueue.front();
+            rxQueue.pop_front();
+        }
+
+        if (config.framed)
+        {
+            const QList<Protocol::Frame> frames = frameParser.feed(QByteArray(1, static_cast<char>(byte.value)));
+            for (const Protocol::Frame &frame : frames)
+            {
+                std::this_thread::sleep_until(byte.arrival);
+                handleFrame(frame);
+            }
+        }
+        else if (byte.value == '\n' || byte.value == '\r')
+        {
+            if (!lineBuffer.isEmpty())
+            {
+                std::this_thread::sleep_until(byte.arrival);
+                handleLine(lineBuffer);
+            }
+            lineBuffer.clear();
+        }
+        else
+        {
+            lineBuffer.append(static_cast<char>(byte.value));
+        }
+    }
+}
+
+void DeviceEmulator::handleLine(const QByteArray &line)
+{
+    std::this_thread::sleep_for(std::chrono::microseconds(config.computeUs));
+    transmit(HostEvaluator::getResult(QString::fromLatin1(line)).toLatin1() + "\r\n"); // Serial.println
+}
+
+void DeviceEmulator::handleFrame(const Protocol::Frame &frame)
+{
+    if (!frame.crcValid)
+    {
+        transmit(Protocol::encodeFrame(frame.seq, Protocol::OpError, QByteArray(1, static_cast<char>(Protocol::ErrCrc))));
+        return;
+    }
+
+    switch (frame.opcode)
+    {
+    case Protocol::OpPing:
+        transmit(Protocol::encodeFrame(frame.seq, Protocol::OpPong, QByteArray()));
+        break;
+    case Protocol::OpHello:
+    {
+        const char reply[] = {static_cast<char>(ProtocolVersion), static_cast<char>(Features & 0xFF),
+                              static_cast<char>(Features >> 8), static_cast<char>(BaudMask)};
+        transmit(Protocol::encodeFrame(frame.seq, Protocol::OpHelloReply, QByteArray(reply, sizeof(reply))));
+        break;
+    }
+    case Protocol::OpSetBaud:
+    {
+        const int index = frame.payload.isEmpty() ? -1 : static_cast<quint8>(frame.payload[0]);
+        if (index < 0 || index >= Protocol::BaudRateCount)
+        {
+            transmit(Protocol::encodeFrame(frame.seq, Protocol::OpError, QByteArray(1, static_cast<char>(Protocol::ErrBadPayload))));
+            break;
+        }
+        transmit(Protocol::encodeFrame(frame.seq, Protocol::OpAck, QByteArray()));
+        // Wie Serial.flush() im Sketch: erst umstellen, wenn das Ack draußen ist
+        for (;;)
+        {
+            {
+                std::lock_guard<std::mutex> lock(txMutex);
+                if (txQueue.isEmpty())
+                    break;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        baudRate = Protocol::BaudRates[index];
+        break;
+    }
+    case Protocol::OpCommitBaud:
+        transmit(Protocol::encodeFrame(frame.seq, Protocol::OpAck, QByteArray()));
+        break;
+    case Protocol::OpEcho:
+        transmit(Protocol::encodeFrame(frame.seq, Protocol::OpEchoReply, frame.payload));
+        break;
+    case Protocol::OpCalc:
+        std::this_thread::sleep_for(std::chrono::microseconds(config.computeUs));
+        sendResult(frame.seq, HostEvaluator::getResult(Protocol::unpackDecimal(frame.payload)));
+        break;
+    case Protocol::OpExec:
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(config.computeUs));
+        float result;
+        quint8 code;
+        if (HostEvaluator::runBytecode(frame.payload, result, code))
+            sendResult(frame.seq, HostEvaluator::formatResult(result));
+        else
+            transmit(Protocol::encodeFrame(frame.seq, Protocol::OpError, QByteArray(1, static_cast<char>(code))));
+        break;
+    }
+    case Protocol::OpCalcF32:
+    case Protocol::OpExecF32:
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(config.computeUs));
+        float result = 0;
+        quint8 code = 0;
+        bool ok;
+        if (frame.opcode == Protocol::OpExecF32)
+        {
+            ok = HostEvaluator::runBytecode(frame.payload, result, code);
+        }
+        else
+        {
+            float num1 = 0, num2 = 0;
+            const char op = frame.payload.size() == 9 ? frame.payload[4] : 0;
+            Protocol::readFloat(frame.payload, 0, num1);
+            Protocol::readFloat(frame.payload, 5, num2);
+            code = applyF32(op, num1, num2, result);
+            ok = code == 0;
+        }
+        if (ok)
+        {
+            QByteArray payload;
+            Protocol::appendFloat(payload, result);
+            transmit(Protocol::encodeFrame(frame.seq, Protocol::OpResultF32, payload));
+        }
+        else
+        {
+            transmit(Protocol::encodeFrame(frame.seq, Protocol::OpError, QByteArray(1, static_cast<char>(code))));
+        }
+        break;
+    }
+    case Protocol::OpCalcBatch:
+        handleBatch(frame);
+        break;
+    default:
+        transmit(Protocol::encodeFrame(frame.seq, Protocol::OpError, QByteArray(1, static_cast<char>(Protocol::ErrUnknownOp))));
+        break;
+    }
+}
+
+// Wie RunBatch() im Sketch: Fehlermaske und je Rechnung float oder Fehlercode
+void DeviceEmulator::handleBatch(const Protocol::Frame &frame)
+{
+    const QByteArray &payload = frame.payload;
+    const int count = payload.isEmpty() ? 0 : static_cast<quint8>(payload[0]);
+    const char shared = payload.size() > 1 ? payload[1] : 0;
+    const int elementSize = shared != 0 ? 8 : 9;
+    if (count == 0 || count > Protocol::MaxBatchCount || payload.size() != 2 + count * elementSize)
+    {
+        transmit(Protocol::encodeFrame(frame.seq, Protocol::OpError, QByteArray(1, static_cast<char>(Protocol::ErrBadPayload))));
+        return;
+    }
+
+    std::this_thread::sleep_for(std::chrono::microseconds(config.computeUs * count));
+    const int maskBytes = (count + 7) / 8;
+    QByteArray reply(1 + maskBytes, '\0');
+    reply[0] = static_cast<char>(count);
+    int offset = 2;
+    for (int i = 0; i < count; i++)
+    {
+        const char op = shared != 0 ? shared : payload[offset++];
+        float num1, num2, result = 0;
+        Protocol::readFloat(payload, offset, num1);
+        Protocol::readFloat(payload, offset + 4, num2);
+        offset += 8;
+        const quint8 code = applyF32(op, num1, num2, result);
+        if (code == 0)
+        {
+            Protocol::appendFloat(reply, result);
+        }
+        else
+        {
+            reply[1 + i / 8] = static_cast<char>(reply[1 + i / 8] | (1 << (i % 8)));
+            reply.append(static_cast<char>(code));
+            reply.append(3, '\0');
+        }
+    }
+    transmit(Protocol::encodeFrame(frame.seq, Protocol::OpResultBatch, reply));
+}
+
+// Wie SendResult() im Sketch: Nullen am Ende weglassen, gepackt oder als Text
+void DeviceEmulator::sendResult(quint8 seq, const QString &response)
+{
+    if (response == Protocol::errorText(Protocol::ErrNoOperator))
+    {
+        transmit(Protocol::encodeFrame(seq, Protocol::OpError, QByteArray(1, static_cast<char>(Protocol::ErrNoOperator))));
+        return;
+    }
+    if (response == Protocol::errorText(Protocol::ErrDivByZero))
+    {
+        transmit(Protocol::encodeFrame(seq, Protocol::OpError, QByteArray(1, static_cast<char>(Protocol::ErrDivByZero))));
+        return;
+    }
+
+    QString trimmed = response;
+    if (trimmed.contains('.'))
+    {
+        while (trimmed.endsWith('0'))
+            trimmed.chop(1);
+        if (trimmed.endsWith('.'))
+            trimmed.chop(1);
+    }
+    QByteArray packed;
+    if (Protocol::packDecimal(trimmed, packed) && !packed.isEmpty())
+        transmit(Protocol::encodeFrame(seq, Protocol::OpResult, packed));
+    else
+        transmit(Protocol::encodeFrame(seq, Protocol::OpResultText, trimmed.toLatin1()));
+}
+
+void DeviceEmulator::transmit(const QByteArray &bytes)
+{
+    {
+        std::lock_guard<std::mutex> lock(txMutex);
+        txQueue += bytes;
+    }
+    eventfd_write(wakeFd, 1);
+}
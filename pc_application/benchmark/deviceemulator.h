@@ -0,0 +1,84 @@
+#ifndef DEVICEEMULATOR_H
+#define DEVICEEMULATOR_H
+
+#include <QString>
+#include <QByteArray>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include "protocol.h"
+
+// Bildet den Arduino an einem Pseudo-Terminal nach (nur Linux). Die Anwendung öffnet
+// slavePath() wie einen echten COM-Port, der Emulator antwortet am Master-Ende wie der
+// Sketch: Ergebnisse über HostEvaluator (GetResult/RunBytecode), Zeitverhalten über
+// die Baudrate (10 Bit pro Byte in beide Richtungen) und eine feste Rechenzeit.
+//
+// Ein I/O-Thread versieht empfangene Bytes mit ihrem Ankunftszeitpunkt auf der Leitung
+// und sendet Antworten im Takt der Baudrate, ein zweiter Thread spielt die CPU des
+// Arduino und arbeitet die Nachrichten nacheinander ab.
+class DeviceEmulator
+{
+public:
+    struct Config
+    {
+        bool framed = true;     // false: alte Firmware, nur Textprotokoll
+        qint32 baudRate = 9600; // Startrate, im Rahmenprotokoll per OpSetBaud änderbar
+        int computeUs = 500;    // Rechenzeit pro Anfrage (atof, Rechnung, dtostrf)
+    };
+
+    explicit DeviceEmulator(const Config &config);
+    ~DeviceEmulator();
+
+    bool start();             // Pseudo-Terminal anlegen und Threads starten
+    void stop();
+    QString slavePath() const; // Pfad für QSerialPort::setPortName()
+    QString errorString() const;
+    quint64 bytesReceived() const { return rxBytes; }
+    quint64 bytesSent() const { return txBytes; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct RxByte
+    {
+        quint8 value;
+        Clock::time_point arrival; // Letztes Bit auf der Leitung
+    };
+
+    void ioLoop();
+    void cpuLoop();
+    void handleLine(const QByteArray &line);
+    void handleFrame(const Protocol::Frame &frame);
+    void handleBatch(const Protocol::Frame &frame);
+    void sendResult(quint8 seq, const QString &response);
+    void transmit(const QByteArray &bytes); // An die Sendewarteschlange des I/O-Threads
+    Clock::duration byteTime() const;
+
+    Config config;
+    int masterFd = -1;
+    int slaveFd = -1;  // Bleibt offen, damit das Master-Ende ohne Anwendung kein EIO liefert
+    int wakeFd = -1;   // eventfd: weckt den I/O-Thread bei neuen Sendedaten
+    QString slaveName;
+    QString error;
+    std::atomic<bool> running{false};
+    std::atomic<qint32> baudRate;
+    std::atomic<quint64> rxBytes{0};
+    std::atomic<quint64> txBytes{0};
+    std::thread ioThread;
+    std::thread cpuThread;
+
+    std::mutex rxMutex;
+    std::condition_variable rxReady;
+    std::deque<RxByte> rxQueue;
+
+    std::mutex txMutex;
+    QByteArray txQueue;
+
+    Protocol::FrameParser frameParser; // Nur im CPU-Thread
+    QByteArray lineBuffer;             // Nur im CPU-Thread
+};
+
+#endif // DEVICEEMULATOR_H
@@ -0,0 +1,66 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTimer>
+#include <cstdio>
+#include "deviceemulator.h"
+#include "benchmarkrunner.h"
+
+// Durchsatz-Benchmark ohne Hardware: startet den Geräteemulator an einem Pseudo-Terminal
+// und misst single, pipelined und batch über den echten seriellen Codepfad.
+//
+//   Calculator_Benchmark --baud 115200 --compute-us 500 --requests 1000
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measures the serial request path against a pseudo-terminal device emulator.");
+    parser.addHelpOption();
+    QCommandLineOption baudOption("baud", "Highest baud rate (default 115200).", "rate", "115200");
+    QCommandLineOption computeOption("compute-us", "Emulated compute time per request in us (default 500).", "us", "500");
+    QCommandLineOption requestsOption("requests", "Requests per workload (default 1000).", "count", "1000");
+    QCommandLineOption windowOption("window", "Requests in flight for pipelined and batch (default 4).", "count", "4");
+    QCommandLineOption protocolOption("protocol", "framed or text (default framed).", "protocol", "framed");
+    QCommandLineOption workloadOption("workload", "single, pipelined, batch or all (default all).", "name", "all");
+    QCommandLineOption floatsOption("binary-floats", "Send operands and results as 4-byte floats.");
+    QCommandLineOption batchSizeOption("batch-size", "Calculations per batch frame, 1 disables batching (default 24).", "count", "24");
+    parser.addOptions({baudOption, computeOption, requestsOption, windowOption, protocolOption, workloadOption, floatsOption,
+                       batchSizeOption});
+    parser.process(app);
+
+    BenchmarkRunner::Options options;
+    options.framed = parser.value(protocolOption) != "text";
+    options.maxBaudRate = parser.value(baudOption).toInt();
+    options.requests = qMax(1, parser.value(requestsOption).toInt());
+    options.window = qMax(1, parser.value(windowOption).toInt());
+    options.binaryFloats = parser.isSet(floatsOption);
+    options.batchSize = parser.value(batchSizeOption).toInt();
+    for (int w = 0; w < BenchmarkRunner::WorkloadCount; w++)
+    {
+        const auto workload = static_cast<BenchmarkRunner::Workload>(w);
+        if (parser.value(workloadOption) == "all" || parser.value(workloadOption) == BenchmarkRunner::workloadName(workload))
+            options.workloads.append(workload);
+    }
+    if (options.workloads.isEmpty() || options.maxBaudRate <= 0)
+    {
+        fprintf(stderr, "Error: unknown workload or invalid baud rate.\n");
+        return 2;
+    }
+
+    DeviceEmulator::Config config;
+    config.framed = options.framed;
+    config.baudRate = options.framed ? Protocol::DefaultBaudRate : options.maxBaudRate; // Rahmen: Rate wird ausgehandelt
+    config.computeUs = qMax(0, parser.value(computeOption).toInt());
+    DeviceEmulator emulator(config);
+    if (!emulator.start())
+    {
+        fprintf(stderr, "Error: %s\n", qPrintable(emulator.errorString()));
+        return 2;
+    }
+
+    BenchmarkRunner runner(options, &emulator);
+    QTimer::singleShot(0, &runner, &BenchmarkRunner::start);
+    const int result = app.exec();
+    emulator.stop();
+    return result;
+}
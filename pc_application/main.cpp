@@ -1,8 +1,21 @@
 #include <QApplication>
+#include <QTimer>
 #include "mainwindow.h"
+#include "batchrunner.h"
 
 int main(int argc, char *argv[])
 {
+    // Batch-Modus ohne GUI, sobald eine Eingabedatei angegeben ist
+    if (BatchRunner::isBatchInvocation(argc, argv))
+    {
+        QCoreApplication app(argc, argv);
+        BatchRunner runner;
+        if (!runner.configure(app.arguments()))
+            return 2;
+        QTimer::singleShot(0, &runner, &BatchRunner::start);
+        return app.exec();
+    }
+
     QApplication app(argc, argv);  // Qt Anwendung starten
     MainWindow window;
     window.show();
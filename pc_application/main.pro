@@ -7,6 +7,41 @@ TARGET = Calculator_Application
 # Im Projektordner
 INCLUDEPATH += $$PWD/src
 SOURCES += main.cpp \
-           src/mainwindow.cpp
+           src/mainwindow.cpp \
+           src/requestengine.cpp \
+           src/protocol.cpp \
+           src/expression.cpp \
+           src/batchrunner.cpp \
+           src/linkmonitor.cpp \
+           src/linknegotiator.cpp \
+           src/expressioncompiler.cpp \
+           src/hostevaluator.cpp \
+           src/latencystats.cpp \
+           src/logmodel.cpp \
+           src/logexporter.cpp \
+           src/errorlog.cpp \
+           src/devicepool.cpp \
+           src/portwatcher.cpp \
+           src/seriallink.cpp
 
-HEADERS += src/mainwindow.h
\ No newline at end of file
+HEADERS += src/mainwindow.h \
+           src/requestengine.h \
+           src/protocol.h \
+           src/expression.h \
+           src/batchrunner.h \
+           src/linkmonitor.h \
+           src/linknegotiator.h \
+           src/expressioncompiler.h \
+           src/hostevaluator.h \
+           src/latencystats.h \
+           src/logmodel.h \
+           src/logexporter.h \
+           src/errorlog.h \
+           src/devicepool.h \
+           src/portwatcher.h \
+           src/seriallink.h \
+           src/spscqueue.h
+
+# Durchsatz-Benchmark gegen einen Geräteemulator am Pseudo-Terminal (nur Linux): make benchmark
+benchmark.commands = $(MKDIR) benchmark_build && cd benchmark_build && $$QMAKE_QMAKE $$PWD/benchmark/benchmark.pro && $(MAKE)
+QMAKE_EXTRA_TARGETS += benchmark
@@ -0,0 +1,289 @@
+#include "batchrunner.h"
+#include "expression.h"
+#include "errorlog.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <algorithm>
+#include <cstdio>
+
+BatchRunner::BatchRunner(QObject *parent)
+    : QObject(parent), pool(new DevicePool(this))
+{
+    connect(pool, &DevicePool::deviceReady, this, [](const QString &portName, bool framed, qint32 baudRate) {
+        fprintf(stderr, "Link %s: %s at %d baud\n", qPrintable(portName),
+                framed ? "framed protocol" : "legacy text protocol", baudRate);
+    });
+    connect(pool, &DevicePool::deviceRemoved, this, [](const QString &portName, const QString &reason) {
+        fprintf(stderr, "Warning: %s removed from the pool: %s\n", qPrintable(portName), qPrintable(reason));
+        ErrorLog::instance().write("Batch: " + portName + " removed from the pool: " + reason);
+    });
+    connect(pool, &DevicePool::ready, this, &BatchRunner::beginStreaming);
+    connect(pool, &DevicePool::jobSent, this, &BatchRunner::handleSent);
+    connect(pool, &DevicePool::jobAnswered, this, &BatchRunner::handleResponse);
+    connect(pool, &DevicePool::jobFailed, this, &BatchRunner::handleFailed);
+}
+
+// Wird vor dem Anlegen der Anwendung geprüft, da der Batch-Modus ohne QApplication läuft
+bool BatchRunner::isBatchInvocation(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (qstrcmp(argv[i], "--in") == 0)
+            return true;
+    }
+    return false;
+}
+
+bool BatchRunner::configure(const QStringList &arguments)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Streams a file of expressions through the calculator device.");
+    parser.addHelpOption();
+    QCommandLineOption portOption("port", "Serial port of the device. Repeat, separate with commas or use 'all' for several devices.", "port");
+    QCommandLineOption inOption("in", "Input file, one expression per line.", "file");
+    QCommandLineOption outOption("out", "Output CSV file.", "file");
+    QCommandLineOption windowOption("window", "Requests in flight at once (default 4).", "count", "4");
+    QCommandLineOption timeoutOption("timeout", "Timeout per request in ms (default 1000).", "ms", "1000");
+    QCommandLineOption delayOption("startup-delay", "Wait after opening the port in ms (default 2000).", "ms", "2000");
+    QCommandLineOption baudOption("max-baud", "Highest baud rate to negotiate (default 1000000).", "rate", "1000000");
+    QCommandLineOption cacheOption("cache-size", "Results kept for repeated expressions, 0 disables (default 1024).", "entries", "1024");
+    QCommandLineOption offloadOption("offload", "Where to compute: device, adaptive or host (default adaptive).", "policy", "adaptive");
+    QCommandLineOption budgetOption("offload-budget", "Adaptive: expected device wait in ms before computing on the PC (default 50).", "ms", "50");
+    QCommandLineOption floatsOption("binary-floats", "Send operands and results as 4-byte floats if the firmware supports it.");
+    QCommandLineOption batchSizeOption("batch-size", "Calculations per batch frame if the firmware supports it, 1 disables (default 24).", "count", "24");
+    parser.addOptions({portOption, inOption, outOption, windowOption, timeoutOption, delayOption, baudOption, cacheOption,
+                       offloadOption, budgetOption, floatsOption, batchSizeOption});
+    parser.process(arguments);
+
+    for (const QString &value : parser.values(portOption))
+    {
+        for (const QString &name : value.split(',', Qt::SkipEmptyParts))
+        {
+            const QStringList names = name == "all" ? DevicePool::availablePorts() : QStringList{name};
+            for (const QString &port : names)
+            {
+                if (!portNames.contains(port))
+                    portNames.append(port);
+            }
+        }
+    }
+    inputPath = parser.value(inOption);
+    outputPath = parser.value(outOption);
+    if (portNames.isEmpty() || inputPath.isEmpty() || outputPath.isEmpty())
+    {
+        fprintf(stderr, "Error: --port, --in and --out are required.\n");
+        return false;
+    }
+
+    pool->setMaxInFlight(parser.value(windowOption).toInt());
+    pool->setTimeout(parser.value(timeoutOption).toInt());
+    startupDelayMs = qMax(0, parser.value(delayOption).toInt());
+    pool->setMaxBaudRate(parser.value(baudOption).toInt());
+    pool->setCacheSize(parser.value(cacheOption).toInt());
+    pool->setBinaryFloats(parser.isSet(floatsOption));
+    pool->setMaxBatchSize(parser.value(batchSizeOption).toInt());
+
+    const QString policy = parser.value(offloadOption);
+    if (policy == "device")
+        pool->setOffloadPolicy(RequestEngine::DeviceOnly);
+    else if (policy == "adaptive")
+        pool->setOffloadPolicy(RequestEngine::Adaptive);
+    else if (policy == "host")
+        pool->setOffloadPolicy(RequestEngine::HostOnly);
+    else
+    {
+        fprintf(stderr, "Error: --offload must be device, adaptive or host.\n");
+        return false;
+    }
+    pool->setOffloadBudget(parser.value(budgetOption).toInt());
+    return true;
+}
+
+void BatchRunner::start()
+{
+    inputFile.setFileName(inputPath);
+    if (!inputFile.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        abort("Could not open input file " + inputPath + ".");
+        return;
+    }
+    outputFile.setFileName(outputPath);
+    if (!outputFile.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate))
+    {
+        abort("Could not open output file " + outputPath + ".");
+        return;
+    }
+    input.setDevice(&inputFile);
+    output.setDevice(&outputFile);
+    output << "line,expression,result,latency_us\n";
+
+    QString lastError;
+    for (const QString &port : portNames)
+    {
+        QString error;
+        if (pool->addDevice(port, error))
+            continue;
+        lastError = "Could not open serial port " + port + ": " + error;
+        fprintf(stderr, "Warning: %s\n", qPrintable(lastError));
+    }
+    if (pool->deviceCount() == 0)
+    {
+        abort(lastError);
+        return;
+    }
+
+    pool->start(startupDelayMs); // Meldet ready(), sobald alle Geräte den Handshake hinter sich haben
+}
+
+void BatchRunner::beginStreaming()
+{
+    clock.start();
+    feed();
+}
+
+// Es werden nur so viele Zeilen gelesen, wie offen sein dürfen: der Speicherbedarf
+// hängt nicht von der Größe der Eingabedatei ab
+void BatchRunner::feed()
+{
+    while (pool->pendingCount() < maxBacklog && !input.atEnd())
+    {
+        const QString expression = input.readLine().trimmed();
+        const quint64 line = inputLine++;
+        if (expression.isEmpty()) // Leerzeilen sind keine Eingabe, auch kein Fehler
+            continue;
+        const quint64 order = linesRead++;
+
+        const Expression::Parsed parsed = Expression::parse(expression);
+        if (parsed.status != Expression::Valid)
+        {
+            errorCount++;
+            store(order, line, expression, "Error: " + Expression::statusText(parsed.status), -1);
+            continue;
+        }
+
+        const quint32 id = pool->submit(Expression::normalize(expression), parsed);
+        pending.insert(id, Pending{order, line, expression, clock.nsecsElapsed(), 0});
+    }
+
+    flushInOrder();
+    if (input.atEnd() && pending.isEmpty())
+        finish();
+}
+
+void BatchRunner::handleSent(quint32 id)
+{
+    auto it = pending.find(id);
+    if (it != pending.end())
+        it->sentAt = clock.nsecsElapsed();
+}
+
+void BatchRunner::handleResponse(quint32 id, const QString &response)
+{
+    complete(id, response, !response.startsWith("Error"));
+}
+
+void BatchRunner::handleFailed(quint32 id, const QString &reason)
+{
+    const auto it = pending.constFind(id);
+    if (it != pending.constEnd())
+        ErrorLog::instance().write(QString("Request #%1 failed (%2): %3").arg(id).arg(it->expression, reason));
+    complete(id, "Error: " + reason, false);
+}
+
+void BatchRunner::complete(quint32 id, const QString &result, bool ok)
+{
+    const auto it = pending.constFind(id);
+    if (it == pending.constEnd())
+        return;
+
+    // Cache-Treffer werden nie gesendet, ihre Latenz zählt ab enqueue()
+    const qint64 startedAt = it->sentAt > 0 ? it->sentAt : it->queuedAt;
+    const qint64 latencyUs = (clock.nsecsElapsed() - startedAt) / 1000;
+    if (ok)
+        latencies.push_back(latencyUs);
+    else
+        errorCount++;
+
+    store(it->order, it->line, it->expression, result, latencyUs);
+    pending.erase(it);
+    feed();
+}
+
+void BatchRunner::store(quint64 order, quint64 line, const QString &expression, const QString &result, qint64 latencyUs)
+{
+    const QString latency = latencyUs >= 0 ? QString::number(latencyUs) : QString();
+    reorder.insert(order, QString::number(line + 1) + ',' + csvField(expression) + ',' + csvField(result) + ',' + latency + '\n');
+}
+
+// Ergebnisse kommen in beliebiger Reihenfolge an, geschrieben wird streng nach Zeilennummer
+void BatchRunner::flushInOrder()
+{
+    auto it = reorder.begin();
+    while (it != reorder.end() && it.key() == nextLineToWrite)
+    {
+        output << it.value();
+        it = reorder.erase(it);
+        nextLineToWrite++;
+    }
+}
+
+void BatchRunner::finish()
+{
+    output.flush();
+    outputFile.close();
+    pool->close();
+
+    const double seconds = clock.isValid() ? clock.nsecsElapsed() / 1e9 : 0.0;
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [this](double p) -> qint64 {
+        if (latencies.empty())
+            return 0;
+        const size_t index = static_cast<size_t>(p * (latencies.size() - 1) + 0.5);
+        return latencies[index];
+    };
+
+    printf("Processed %llu expressions in %.3f s (%llu errors)\n",
+           static_cast<unsigned long long>(linesRead), seconds, static_cast<unsigned long long>(errorCount));
+    printf("Throughput: %.1f ops/s\n", seconds > 0 ? linesRead / seconds : 0.0);
+    printf("Latency: p50 %lld us, p99 %lld us\n",
+           static_cast<long long>(percentile(0.50)), static_cast<long long>(percentile(0.99)));
+    quint64 cacheHits = 0;
+    quint64 cacheMisses = 0;
+    quint64 hostEvaluations = 0;
+    const QList<DevicePool::DeviceStats> devices = pool->stats();
+    for (const DevicePool::DeviceStats &device : devices)
+    {
+        cacheHits += device.cacheHits;
+        cacheMisses += device.cacheMisses;
+        hostEvaluations += device.hostEvaluations;
+    }
+    printf("Cache: %llu hits, %llu misses\n",
+           static_cast<unsigned long long>(cacheHits), static_cast<unsigned long long>(cacheMisses));
+    printf("Computed on PC: %llu\n", static_cast<unsigned long long>(hostEvaluations));
+    for (const DevicePool::DeviceStats &device : devices)
+    {
+        printf("Device %s: %llu done, %llu stolen, RTT %lld us%s\n", qPrintable(device.portName),
+               static_cast<unsigned long long>(device.completed), static_cast<unsigned long long>(device.stolen),
+               static_cast<long long>(device.rttUs), device.active ? "" : " (removed)");
+    }
+    if (ErrorLog::instance().droppedCount() > 0)
+        printf("Error log: %llu messages dropped\n", static_cast<unsigned long long>(ErrorLog::instance().droppedCount()));
+    fflush(stdout);
+
+    QCoreApplication::exit(0);
+}
+
+void BatchRunner::abort(const QString &message)
+{
+    fprintf(stderr, "Error: %s\n", qPrintable(message));
+    QCoreApplication::exit(1);
+}
+
+QString BatchRunner::csvField(const QString &field)
+{
+    if (!field.contains(',') && !field.contains('"'))
+        return field;
+    QString quoted = field;
+    quoted.replace("\"", "\"\"");
+    return '"' + quoted + '"';
+}
@@ -0,0 +1,78 @@
+#ifndef BATCHRUNNER_H
+#define BATCHRUNNER_H
+
+#include <QObject>
+#include <QFile>
+#include <QTextStream>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMap>
+#include <vector>
+#include "devicepool.h"
+
+// Batch-Modus ohne GUI: liest Ausdrücke zeilenweise aus einer Datei, schickt sie
+// über die Anfrage-Engine an den µC und schreibt die Ergebnisse in Eingabereihenfolge.
+// Mit mehreren Ports werden die Ausdrücke über alle Geräte verteilt (siehe DevicePool).
+//
+//   Calculator_Application --port COM3 --in exprs.txt --out results.csv
+//   Calculator_Application --port COM3,COM4 --in exprs.txt --out results.csv
+//   Calculator_Application --port all --in exprs.txt --out results.csv
+class BatchRunner : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit BatchRunner(QObject *parent = nullptr);
+
+    static bool isBatchInvocation(int argc, char *argv[]); // true, wenn --in angegeben wurde
+    bool configure(const QStringList &arguments);         // Kommandozeile auswerten, false bei Fehlern
+
+public slots:
+    void start(); // Ports öffnen und nach dem Handshake aller Geräte mit dem Senden beginnen
+
+private slots:
+    void handleSent(quint32 id);
+    void handleResponse(quint32 id, const QString &response);
+    void handleFailed(quint32 id, const QString &reason);
+
+private:
+    struct Pending
+    {
+        quint64 order;      // Reihenfolge in der Ausgabe
+        quint64 line;       // Zeilennummer in der Eingabedatei
+        QString expression; // Eingabe wie in der Datei
+        qint64 queuedAt;    // Zeitpunkt von enqueue() in ns
+        qint64 sentAt;      // Sendezeitpunkt in ns, 0 solange noch nicht gesendet (oder Cache-Treffer)
+    };
+
+    void beginStreaming();                                                             // Eingabe öffnen und Engine füllen
+    void feed();                                                                       // Liest Zeilen nach, solange der Rückstau es erlaubt
+    void complete(quint32 id, const QString &result, bool ok);                         // Ergebnis einer Anfrage übernehmen
+    void store(quint64 order, quint64 line, const QString &expression, const QString &result, qint64 latencyUs); // Ergebnis zwischenspeichern
+    void flushInOrder();                                                               // Zusammenhängende Ergebnisse schreiben
+    void finish();                                                                     // Statistik ausgeben und beenden
+    void abort(const QString &message);                                                // Mit Fehlermeldung beenden
+    static QString csvField(const QString &field);                                     // CSV-Feld bei Bedarf quotieren
+
+    DevicePool *pool;
+    QFile inputFile;
+    QFile outputFile;
+    QTextStream input;
+    QTextStream output;
+    QElapsedTimer clock;                 // Monotone Uhr für Laufzeit und Latenzen
+    QHash<quint32, Pending> pending;     // Offene Anfragen nach Anfrage-ID
+    QMap<quint64, QString> reorder;      // Fertige Zeilen, die noch auf Vorgänger warten
+    std::vector<qint64> latencies;       // Latenzen erfolgreicher Anfragen in µs
+    quint64 linesRead = 0;               // Anzahl gelesener Ausdrücke (ohne Leerzeilen)
+    quint64 inputLine = 0;               // Zeilennummer in der Eingabedatei, mit Leerzeilen
+    quint64 nextLineToWrite = 0;         // Nächster Ausdruck für die Ausgabe
+    quint64 errorCount = 0;              // Ungültige Eingaben, Gerätefehler und Timeouts
+
+    QStringList portNames;
+    QString inputPath;
+    QString outputPath;
+    int startupDelayMs = 2000; // Der Arduino startet beim Öffnen des Ports neu
+    int maxBacklog = 256;      // Maximale Anzahl offener Anfragen in allen Geräten zusammen
+};
+
+#endif // BATCHRUNNER_H
@@ -0,0 +1,350 @@
+#include "devicepool.h"
+#include "hostevaluator.h"
+#include <QSerialPortInfo>
+#include <QTimer>
+#include <algorithm>
+
+DevicePool::DevicePool(QObject *parent)
+    : QObject(parent)
+{
+}
+
+DevicePool::~DevicePool()
+{
+    // Port, Engine usw. sind QObject-Kinder des Pools; die Lambdas dürfen danach
+    // nicht mehr auf die Verwaltungsdaten zugreifen
+    for (Device *device : devices)
+    {
+        device->serial->disconnect(this);
+        device->engine->disconnect(this);
+        device->monitor->disconnect(this);
+        device->negotiator->disconnect(this);
+    }
+    qDeleteAll(devices);
+}
+
+QStringList DevicePool::availablePorts()
+{
+    QStringList names;
+    for (const QSerialPortInfo &info : QSerialPortInfo::availablePorts())
+        names.append(info.portName());
+    return names;
+}
+
+void DevicePool::setMaxInFlight(int count)
+{
+    windowSize = qMax(1, count);
+}
+
+void DevicePool::setTimeout(int ms)
+{
+    timeoutMs = ms;
+}
+
+void DevicePool::setMaxBaudRate(qint32 baudRate)
+{
+    maxBaudRate = baudRate;
+}
+
+void DevicePool::setCacheSize(int entries)
+{
+    cacheEntries = entries;
+}
+
+void DevicePool::setOffloadPolicy(RequestEngine::OffloadPolicy policy)
+{
+    this->policy = policy;
+}
+
+void DevicePool::setOffloadBudget(int ms)
+{
+    offloadBudgetMs = ms;
+}
+
+void DevicePool::setBinaryFloats(bool enabled)
+{
+    floatWire = enabled;
+}
+
+void DevicePool::setMaxBatchSize(int count)
+{
+    batchSize = count;
+}
+
+bool DevicePool::addDevice(const QString &portName, QString &error)
+{
+    QSerialPort *serial = new QSerialPort(this);
+    serial->setPortName(portName);
+    serial->setBaudRate(Protocol::DefaultBaudRate);
+    serial->setDataBits(QSerialPort::Data8);
+    serial->setParity(QSerialPort::NoParity);
+    serial->setStopBits(QSerialPort::OneStop);
+    serial->setFlowControl(QSerialPort::NoFlowControl);
+    if (!serial->open(QIODevice::ReadWrite))
+    {
+        error = serial->errorString();
+        delete serial;
+        return false;
+    }
+
+    Device *device = new Device;
+    device->portName = portName;
+    device->serial = serial;
+    device->engine = new RequestEngine(serial, this);
+    device->engine->setMaxInFlight(windowSize);
+    device->engine->setTimeout(timeoutMs);
+    device->engine->setCacheSize(cacheEntries);
+    device->engine->setOffloadPolicy(policy);
+    device->engine->setOffloadBudget(offloadBudgetMs);
+    device->engine->setBinaryFloats(floatWire);
+    device->engine->setMaxBatchSize(batchSize);
+    device->negotiator = new LinkNegotiator(serial, device->engine, this);
+    device->negotiator->setMaxBaudRate(maxBaudRate);
+    device->monitor = new LinkMonitor(serial, device->engine, this);
+    devices.append(device);
+
+    connect(device->negotiator, &LinkNegotiator::finished, this, [this, device](bool framed, qint32 baudRate) {
+        handleNegotiated(device, framed, baudRate);
+    });
+    connect(device->monitor, &LinkMonitor::connectionStatusChanged, this, [this, device](bool alive) {
+        if (!alive)
+            removeLater(device, "Connection lost.");
+    });
+    // Auch während des Handshakes, bevor die Überwachung läuft
+    connect(serial, &QSerialPort::errorOccurred, this, [this, device](QSerialPort::SerialPortError portError) {
+        if (portError == QSerialPort::ResourceError || portError == QSerialPort::DeviceNotFoundError)
+            removeLater(device, device->serial->errorString());
+    });
+
+    connect(device->engine, &RequestEngine::requestSent, this, [this, device](quint32 id, const QString &) {
+        const auto it = device->inEngine.constFind(id);
+        if (it != device->inEngine.constEnd())
+            emit jobSent(it->id);
+    });
+    connect(device->engine, &RequestEngine::responseReceived, this,
+            [this, device](quint32 id, const QString &, const QString &response) {
+                const auto it = device->inEngine.find(id);
+                if (it == device->inEngine.end())
+                    return;
+                const quint32 job = it->id;
+                device->inEngine.erase(it);
+                device->completed++;
+                pump(device);
+                emit jobAnswered(job, response);
+            });
+    connect(device->engine, &RequestEngine::requestFailed, this,
+            [this, device](quint32 id, const QString &, const QString &reason) {
+                const auto it = device->inEngine.find(id);
+                if (it == device->inEngine.end())
+                    return;
+                const quint32 job = it->id;
+                device->inEngine.erase(it);
+                pump(device);
+                emit jobFailed(job, reason);
+            });
+    return true;
+}
+
+void DevicePool::start(int startupDelayMs)
+{
+    for (Device *device : devices)
+    {
+        QTimer::singleShot(startupDelayMs, this, [this, device]() {
+            if (device->active)
+                negotiate(device);
+        });
+    }
+    checkReady(); // Ohne Geräte sofort bereit
+}
+
+void DevicePool::close()
+{
+    for (Device *device : devices)
+    {
+        device->monitor->disconnect(this);
+        device->monitor->stop();
+        device->negotiator->cancel();
+        device->serial->close();
+    }
+}
+
+quint32 DevicePool::submit(const QString &expression, const Expression::Parsed &parsed)
+{
+    const Job job{nextJobId++, expression, parsed};
+    if (readyEmitted)
+        assign(job);
+    else
+        unassigned.append(job);
+    return job.id;
+}
+
+int DevicePool::pendingCount() const
+{
+    int count = unassigned.size() + answersPending;
+    for (const Device *device : devices)
+        count += device->local.size() + device->inEngine.size();
+    return count;
+}
+
+int DevicePool::deviceCount() const
+{
+    return static_cast<int>(std::count_if(devices.begin(), devices.end(), [](const Device *device) { return device->active; }));
+}
+
+QList<DevicePool::DeviceStats> DevicePool::stats() const
+{
+    QList<DeviceStats> list;
+    for (const Device *device : devices)
+    {
+        list.append(DeviceStats{device->portName, device->active, device->completed, device->stolen,
+                                device->engine->cacheHits(), device->engine->cacheMisses(),
+                                device->engine->hostEvaluations(), device->engine->deviceRttUs()});
+    }
+    return list;
+}
+
+void DevicePool::negotiate(Device *device)
+{
+    device->serial->clear(); // Bootmeldungen oder Reste vom Reset verwerfen
+    device->negotiator->start();
+}
+
+void DevicePool::handleNegotiated(Device *device, bool framed, qint32 baudRate)
+{
+    if (!device->active)
+        return;
+    device->engine->setDeviceFeatures(framed ? device->negotiator->deviceInfo().features : 0);
+    device->negotiated = true;
+    device->monitor->start();
+    emit deviceReady(device->portName, framed, baudRate);
+    checkReady();
+}
+
+// Portfehler kommen auch aus serial->write() mitten in RequestEngine::pump()
+void DevicePool::removeLater(Device *device, const QString &reason)
+{
+    QMetaObject::invokeMethod(this, [this, device, reason]() { remove(device, reason); }, Qt::QueuedConnection);
+}
+
+void DevicePool::remove(Device *device, const QString &reason)
+{
+    if (!device->active)
+        return;
+    device->active = false;
+
+    // Offene Aufträge selbst übernehmen, bevor die Engine sie verwirft
+    QList<Job> orphaned = device->inEngine.values();
+    std::sort(orphaned.begin(), orphaned.end(), [](const Job &a, const Job &b) { return a.id < b.id; });
+    orphaned += device->local;
+    device->inEngine.clear();
+    device->local.clear();
+
+    device->engine->disconnect(this);
+    device->monitor->disconnect(this);
+    device->serial->disconnect(this);
+    device->negotiator->cancel();
+    device->monitor->stop();
+    device->engine->clear();
+    device->serial->close();
+    emit deviceRemoved(device->portName, reason);
+
+    for (const Job &job : orphaned)
+    {
+        if (readyEmitted)
+            assign(job);
+        else
+            unassigned.append(job);
+    }
+    checkReady(); // Das entfernte Gerät war vielleicht das letzte im Handshake
+}
+
+void DevicePool::assign(const Job &job)
+{
+    Device *target = nullptr;
+    int targetLoad = 0;
+    for (Device *device : devices)
+    {
+        if (!device->active || !device->negotiated)
+            continue;
+        const int load = device->local.size() + device->inEngine.size();
+        if (target == nullptr || load < targetLoad)
+        {
+            target = device;
+            targetLoad = load;
+        }
+    }
+    if (target == nullptr)
+    {
+        answerWithoutDevice(job);
+        return;
+    }
+    target->local.append(job);
+    pump(target);
+}
+
+void DevicePool::pump(Device *device)
+{
+    if (!device->active || !device->negotiated)
+        return;
+    // Mit OpCalcBatch: genug für den Rahmen unterwegs und einen vollen nächsten
+    const int backlog = qMax(windowSize * BacklogPerWindow, 2 * device->engine->batchCapacity());
+    while (device->inEngine.size() < backlog)
+    {
+        if (device->local.isEmpty() && !steal(device))
+            break;
+        const Job job = device->local.takeFirst();
+        const quint32 id = device->engine->enqueue(job.expression, job.parsed);
+        device->inEngine.insert(id, job);
+    }
+}
+
+bool DevicePool::steal(Device *thief)
+{
+    Device *victim = nullptr;
+    for (Device *device : devices)
+    {
+        if (device != thief && device->active && !device->local.isEmpty()
+            && (victim == nullptr || device->local.size() > victim->local.size()))
+            victim = device;
+    }
+    if (victim == nullptr)
+        return false;
+
+    // Hinten stehen die zuletzt zugeteilten Aufträge, das Opfer arbeitet vorne weiter
+    const int count = (victim->local.size() + 1) / 2;
+    const int first = victim->local.size() - count;
+    thief->local += victim->local.mid(first);
+    victim->local.remove(first, count);
+    thief->stolen += count;
+    return true;
+}
+
+// Wie RequestEngine::answerLater: das Signal kommt erst nach Rückkehr von submit()
+void DevicePool::answerWithoutDevice(const Job &job)
+{
+    answersPending++;
+    QMetaObject::invokeMethod(this, [this, job]() {
+        answersPending--;
+        if (policy == RequestEngine::DeviceOnly)
+            emit jobFailed(job.id, "No device available");
+        else
+            emit jobAnswered(job.id, HostEvaluator::evaluate(job.expression, job.parsed));
+    }, Qt::QueuedConnection);
+}
+
+void DevicePool::checkReady()
+{
+    if (readyEmitted)
+        return;
+    for (const Device *device : devices)
+    {
+        if (device->active && !device->negotiated)
+            return;
+    }
+    readyEmitted = true;
+    const QList<Job> jobs = unassigned;
+    unassigned.clear();
+    for (const Job &job : jobs)
+        assign(job);
+    emit ready();
+}
@@ -0,0 +1,120 @@
+#ifndef DEVICEPOOL_H
+#define DEVICEPOOL_H
+
+#include <QObject>
+#include <QSerialPort>
+#include <QHash>
+#include <QList>
+#include <QStringList>
+#include "requestengine.h"
+#include "linkmonitor.h"
+#include "linknegotiator.h"
+#include "expression.h"
+
+// Mehrere Geräte gleichzeitig: jedes hat seinen eigenen Port, seine eigene Anfrage-Engine
+// und seinen eigenen Handshake. Aufträge werden per Work-Stealing verteilt: jedes Gerät
+// hat eine lokale Warteschlange, aus der es vorne nimmt; ist sie leer, stiehlt es die
+// hintere Hälfte der längsten fremden Warteschlange. Die Engine eines Geräts bekommt nur
+// so viele Aufträge, wie ihr Fenster gerade braucht, der Rest bleibt umverteilbar.
+// Getrennte Geräte verlassen den Pool, ihre offenen Aufträge gehen an die übrigen.
+class DevicePool : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DevicePool(QObject *parent = nullptr);
+    ~DevicePool();
+
+    static QStringList availablePorts(); // Alle Ports aus QSerialPortInfo::availablePorts()
+
+    // Vor start() setzen, gelten für jedes Gerät
+    void setMaxInFlight(int count);
+    void setTimeout(int ms);
+    void setMaxBaudRate(qint32 baudRate);
+    void setCacheSize(int entries);
+    void setOffloadPolicy(RequestEngine::OffloadPolicy policy);
+    void setOffloadBudget(int ms);
+    void setBinaryFloats(bool enabled);
+    void setMaxBatchSize(int count);
+
+    bool addDevice(const QString &portName, QString &error); // Öffnet den Port
+    void start(int startupDelayMs);                           // Handshake aller Geräte nach dem Reset des Arduino
+    void close();                                             // Alle Ports schließen
+
+    quint32 submit(const QString &expression, const Expression::Parsed &parsed); // Liefert die Auftrags-ID
+    int pendingCount() const; // Noch nicht beantwortete Aufträge
+    int deviceCount() const;  // Geräte, die noch im Pool sind
+
+    struct DeviceStats
+    {
+        QString portName;
+        bool active;
+        quint64 completed;       // Beantwortete Aufträge
+        quint64 stolen;          // Von anderen Geräten übernommene Aufträge
+        quint64 cacheHits;
+        quint64 cacheMisses;
+        quint64 hostEvaluations; // Von der Engine auf dem PC gerechnet
+        qint64 rttUs;
+    };
+    QList<DeviceStats> stats() const;
+
+signals:
+    void deviceReady(const QString &portName, bool framed, qint32 baudRate); // Handshake abgeschlossen
+    void deviceRemoved(const QString &portName, const QString &reason);     // Verbindung verloren
+    void ready();                                                           // Alle Handshakes abgeschlossen
+    void jobSent(quint32 job);
+    void jobAnswered(quint32 job, const QString &response);
+    void jobFailed(quint32 job, const QString &reason);
+
+private:
+    struct Job
+    {
+        quint32 id;
+        QString expression;
+        Expression::Parsed parsed;
+    };
+
+    struct Device
+    {
+        QString portName;
+        QSerialPort *serial;
+        RequestEngine *engine;
+        LinkNegotiator *negotiator;
+        LinkMonitor *monitor;
+        QList<Job> local;             // Noch nicht an die Engine übergeben, vorne: eigene, hinten: zum Stehlen
+        QHash<quint32, Job> inEngine; // Anfrage-ID der Engine -> Auftrag
+        bool negotiated = false;
+        bool active = true;
+        quint64 completed = 0;
+        quint64 stolen = 0;
+    };
+
+    void negotiate(Device *device);
+    void handleNegotiated(Device *device, bool framed, qint32 baudRate);
+    void removeLater(Device *device, const QString &reason); // Nicht mitten in einem Signal der Engine abbauen
+    void remove(Device *device, const QString &reason);
+    void assign(const Job &job);              // An das Gerät mit der kürzesten Warteschlange
+    void pump(Device *device);                // Engine bis zu ihrem Rückstau füllen
+    bool steal(Device *thief);                // Hälfte der längsten fremden Warteschlange übernehmen
+    void answerWithoutDevice(const Job &job); // Kein Gerät mehr: auf dem PC rechnen oder scheitern
+    void checkReady();
+
+    QList<Device *> devices;   // In der Reihenfolge von addDevice(), entfernte bleiben für die Statistik
+    QList<Job> unassigned;     // Aufträge vor dem Ende der Handshakes
+    quint32 nextJobId = 1;
+    int answersPending = 0;    // Aufträge ohne Gerät, deren Signal noch aussteht
+    bool readyEmitted = false;
+
+    int windowSize = 4;
+    int timeoutMs = 1000;
+    qint32 maxBaudRate = 1000000;
+    int cacheEntries = 1024;
+    RequestEngine::OffloadPolicy policy = RequestEngine::DeviceOnly;
+    int offloadBudgetMs = 50;
+    bool floatWire = false;
+    int batchSize = Protocol::MaxBatchCount;
+
+    static constexpr int BacklogPerWindow = 2; // Aufträge je Engine: Fenster mal diesen Faktor
+};
+
+#endif // DEVICEPOOL_H
@@ -0,0 +1,158 @@
+#include "errorlog.h"
+#include <QDateTime>
+#include <QDir>
+#include <chrono>
+
+ErrorLog::ErrorLog(const QString &path)
+    : filePath(path), head(new Node), tail(head.load())
+{
+    thread = std::thread(&ErrorLog::run, this);
+}
+
+ErrorLog::~ErrorLog()
+{
+    running.store(false);
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+    }
+    wake.notify_one();
+    thread.join();
+    delete tail; // Nur noch der Platzhalter, run() hat alles geleert
+}
+
+ErrorLog &ErrorLog::instance()
+{
+    static ErrorLog log(QDir::currentPath() + "/error_log.txt");
+    return log;
+}
+
+void ErrorLog::write(const QString &message)
+{
+    // Platz reservieren statt zu warten; der Zähler darf kurz über der Kapazität stehen
+    if (queued.fetch_add(1, std::memory_order_relaxed) >= QueueCapacity)
+    {
+        queued.fetch_sub(1, std::memory_order_relaxed);
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    Node *node = new Node;
+    node->timestamp = QDateTime::currentMSecsSinceEpoch();
+    node->message = message;
+
+    // Einreihen nach Vyukov: ein exchange, danach wird der Vorgänger verkettet
+    Node *previous = head.exchange(node, std::memory_order_acq_rel);
+    previous->next.store(node, std::memory_order_release);
+
+    // Halb voll: Schreib-Thread nicht erst nach FlushIntervalMs wecken
+    if (queued.load(std::memory_order_relaxed) >= QueueCapacity / 2)
+        flush();
+}
+
+void ErrorLog::flush()
+{
+    // notify_one() ohne Mutex blockiert nicht. Geht das Wecken verloren, weil der Thread
+    // gerade erst einschläft, schreibt er spätestens nach FlushIntervalMs.
+    if (!wakeRequested.exchange(true, std::memory_order_acq_rel))
+        wake.notify_one();
+}
+
+bool ErrorLog::pop(qint64 &timestamp, QString &message)
+{
+    Node *next = tail->next.load(std::memory_order_acquire);
+    if (next == nullptr) // Leer, oder ein Erzeuger hat seinen Knoten noch nicht verkettet
+        return false;
+
+    timestamp = next->timestamp;
+    message = std::move(next->message);
+    delete tail;
+    tail = next; // Der gelesene Knoten wird zum neuen Platzhalter
+    queued.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+void ErrorLog::run()
+{
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point lastWrite = Clock::now();
+
+    while (running.load())
+    {
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wake.wait_for(lock, std::chrono::milliseconds(FlushIntervalMs), [this]() {
+                return wakeRequested.load() || !running.load();
+            });
+        }
+        const bool requested = wakeRequested.exchange(false);
+
+        drain();
+        const Clock::time_point now = Clock::now();
+        if (requested || buffer.size() >= FlushBytes || now - lastWrite >= std::chrono::milliseconds(FlushIntervalMs))
+        {
+            writeBuffer();
+            lastWrite = now;
+        }
+    }
+
+    drain();
+    writeBuffer();
+}
+
+void ErrorLog::drain()
+{
+    qint64 timestamp;
+    QString message;
+    while (pop(timestamp, message))
+    {
+        buffer += QDateTime::fromMSecsSinceEpoch(timestamp).toString("yyyy-MM-dd HH:mm:ss").toUtf8();
+        buffer += " - ";
+        buffer += message.toUtf8();
+        buffer += '\n';
+        written.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    const quint64 drops = dropped.load(std::memory_order_relaxed);
+    if (drops != reportedDrops)
+    {
+        buffer += QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss").toUtf8();
+        buffer += QString(" - %1 messages dropped (queue full)\n").arg(drops - reportedDrops).toUtf8();
+        reportedDrops = drops;
+    }
+}
+
+void ErrorLog::writeBuffer()
+{
+    if (buffer.isEmpty())
+        return;
+
+    if (!file.isOpen())
+    {
+        file.setFileName(filePath);
+        if (!file.open(QIODevice::Append | QIODevice::Text))
+        {
+            buffer.clear(); // Ohne Datei nicht endlos puffern
+            return;
+        }
+    }
+    if (file.size() > 0 && file.size() + buffer.size() > MaxFileBytes)
+        rotate();
+
+    if (file.isOpen())
+    {
+        file.write(buffer);
+        file.flush();
+    }
+    buffer.clear();
+}
+
+// error_log.txt -> error_log.txt.1 -> ... -> error_log.txt.KeepFiles (wird gelöscht)
+void ErrorLog::rotate()
+{
+    file.close();
+    QFile::remove(filePath + '.' + QString::number(KeepFiles));
+    for (int i = KeepFiles - 1; i >= 1; i--)
+        QFile::rename(filePath + '.' + QString::number(i), filePath + '.' + QString::number(i + 1));
+    QFile::rename(filePath, filePath + ".1");
+    file.open(QIODevice::Append | QIODevice::Text);
+}
@@ -0,0 +1,68 @@
+#ifndef ERRORLOG_H
+#define ERRORLOG_H
+
+#include <QString>
+#include <QFile>
+#include <QByteArray>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Fehlerprotokoll mit eigenem Schreib-Thread. write() hängt die Meldung nur an eine
+// lock-freie Warteschlange (mehrere Erzeuger, ein Verbraucher) und kehrt sofort zurück;
+// der Thread formatiert, puffert und schreibt gesammelt. Ist die Warteschlange voll,
+// wird die Meldung verworfen und gezählt statt zu warten.
+class ErrorLog
+{
+public:
+    explicit ErrorLog(const QString &path);
+    ~ErrorLog(); // Schreibt alle noch wartenden Meldungen
+
+    static ErrorLog &instance(); // error_log.txt im Arbeitsverzeichnis
+
+    void write(const QString &message); // Von jedem Thread aus aufrufbar, blockiert nie
+    void flush();                        // Weckt den Schreib-Thread, wartet aber nicht auf ihn
+
+    quint64 writtenCount() const { return written.load(std::memory_order_relaxed); }
+    quint64 droppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+    static constexpr int QueueCapacity = 4096;          // Maximal wartende Meldungen
+    static constexpr int FlushBytes = 64 * 1024;        // Puffer wird spätestens ab dieser Größe geschrieben
+    static constexpr int FlushIntervalMs = 1000;        // ... oder nach dieser Zeit
+    static constexpr qint64 MaxFileBytes = 1024 * 1024; // Danach wird rotiert: .1, .2, ...
+    static constexpr int KeepFiles = 3;                 // Anzahl aufbewahrter alter Dateien
+
+private:
+    struct Node
+    {
+        std::atomic<Node *> next{nullptr};
+        qint64 timestamp = 0; // ms seit Epoch, beim Aufruf von write() erfasst
+        QString message;
+    };
+
+    void run();                          // Schleife des Schreib-Threads
+    bool pop(qint64 &timestamp, QString &message); // Nur vom Schreib-Thread
+    void drain();                        // Warteschlange in den Puffer übernehmen
+    void writeBuffer();                  // Puffer in die Datei schreiben, ggf. rotieren
+    void rotate();
+
+    QString filePath;
+    QFile file;         // Erst beim ersten Schreiben geöffnet, gehört dem Schreib-Thread
+    QByteArray buffer;  // Formatierte, noch nicht geschriebene Zeilen
+    quint64 reportedDrops = 0; // Bereits im Protokoll vermerkte verworfene Meldungen
+
+    std::atomic<Node *> head; // Zuletzt angehängter Knoten (Erzeuger)
+    Node *tail;               // Platzhalter vor dem ältesten Knoten (Verbraucher)
+    std::atomic<int> queued{0};
+    std::atomic<quint64> written{0};
+    std::atomic<quint64> dropped{0};
+    std::atomic<bool> running{true};
+    std::atomic<bool> wakeRequested{false};
+
+    std::mutex wakeMutex; // Nur für die Wartezeit des Schreib-Threads
+    std::condition_variable wake;
+    std::thread thread;
+};
+
+#endif // ERRORLOG_H
@@ -0,0 +1,182 @@
+#include "expression.h"
+#include "expressioncompiler.h"
+#include <charconv>
+
+namespace Expression
+{
+
+// Zahl wie im regulären Ausdruck des alten Textprotokolls: [-+]?[0-9]*\.?[0-9]+
+// Die Zeichen werden auf dem Stack gesammelt und mit from_chars umgewandelt, das im
+// Gegensatz zu strtod nicht von der Locale abhängt.
+static bool scanNumber(QStringView input, int &pos, float &value)
+{
+    char buffer[64];
+    int length = 0;
+    int i = pos;
+    if (i < input.size() && (input[i] == '+' || input[i] == '-'))
+    {
+        if (input[i] == '-')
+            buffer[length++] = '-';
+        i++;
+    }
+
+    int digits = 0;
+    bool dot = false;
+    for (; i < input.size() && length < int(sizeof(buffer)); i++)
+    {
+        const char16_t ch = input[i].unicode();
+        if (ch >= '0' && ch <= '9')
+        {
+            buffer[length++] = static_cast<char>(ch);
+            digits++;
+        }
+        else if ((ch == '.' || ch == ',') && !dot)
+        {
+            buffer[length++] = '.';
+            dot = true;
+            digits = 0; // Nach dem Punkt muss mindestens eine Ziffer folgen
+        }
+        else
+        {
+            break;
+        }
+    }
+    if (digits == 0 || length == int(sizeof(buffer))) // Sehr lange Zahlen übernimmt der Compiler
+        return false;
+
+    double number;
+    const std::from_chars_result result = std::from_chars(buffer, buffer + length, number);
+    if (result.ec != std::errc() || result.ptr != buffer + length)
+        return false;
+    value = static_cast<float>(number); // avr-libc liefert bei atof direkt einen float
+    pos = i;
+    return true;
+}
+
+static void skipSpaces(QStringView input, int &pos)
+{
+    while (pos < input.size() && input[pos].isSpace())
+        pos++;
+}
+
+// Der häufige Fall <Zahl><Operator><Zahl> wird direkt erkannt. Nur für Klammern, Rangfolge
+// und mehrere Operatoren wird der Ausdruck übersetzt.
+Parsed parse(QStringView input)
+{
+    Parsed parsed;
+    int pos = 0;
+    if (scanNumber(input, pos, parsed.left))
+    {
+        skipSpaces(input, pos);
+        const char16_t op = pos < input.size() ? input[pos].unicode() : 0;
+        if (op == '+' || op == '-' || op == '*' || op == '/')
+        {
+            pos++;
+            skipSpaces(input, pos);
+            if (scanNumber(input, pos, parsed.right) && pos == input.size())
+            {
+                parsed.simple = true;
+                parsed.op = static_cast<char>(op);
+                parsed.status = op == '/' && parsed.right == 0 ? DivisionByZero : Valid;
+                return parsed;
+            }
+        }
+    }
+
+    const CompiledExpression compiled = ExpressionCompiler::compile(normalize(input.toString()));
+    switch (compiled.status)
+    {
+    case CompiledExpression::Ok:
+        parsed.status = Valid;
+        break;
+    case CompiledExpression::DivisionByZero:
+        parsed.status = DivisionByZero;
+        break;
+    case CompiledExpression::TooComplex:
+        parsed.status = TooComplex;
+        break;
+    default:
+        parsed.status = InvalidFormat; // Eingabe ungültig
+        break;
+    }
+    return parsed;
+}
+
+QString statusText(Status status)
+{
+    switch (status)
+    {
+    case InvalidFormat:
+        return "Invalid input format! Use numbers, + - * / and parentheses, e.g. (1.5+2)*-3.";
+    case DivisionByZero:
+        return "Division by zero is not allowed!";
+    case TooComplex:
+        return "Expression is too complex for the device!";
+    default:
+        return QString();
+    }
+}
+
+QString normalize(const QString &input)
+{
+    if (!input.contains(','))
+        return input; // Geteilte Kopie, keine Allokation
+    QString normalized = input;
+    normalized.replace(',', '.'); // Ersetze Kommas durch Punkte
+    return normalized;
+}
+
+// Zahl ohne führende Nullen und ohne Nullen am Ende der Nachkommastellen
+static void appendCanonicalNumber(QString &out, QStringView number)
+{
+    int dot = number.indexOf('.');
+    QStringView integer = dot < 0 ? number : number.left(dot);
+    QStringView fraction = dot < 0 ? QStringView() : number.mid(dot + 1);
+    while (integer.size() > 1 && integer.front() == '0')
+        integer = integer.mid(1);
+    while (!fraction.isEmpty() && fraction.back() == '0')
+        fraction.chop(1);
+    out += integer.isEmpty() ? QStringView(u"0") : integer;
+    if (!fraction.isEmpty())
+    {
+        out += '.';
+        out += fraction;
+    }
+}
+
+// Gleichwertige Schreibweisen ergeben denselben Schlüssel. Es wird nur umgeschrieben,
+// was den Wert garantiert nicht ändert: Leerzeichen, unäres Plus und Nullen.
+QString canonical(const QString &normalized)
+{
+    QString out;
+    out.reserve(normalized.size());
+    bool operandExpected = true; // Am Anfang, nach einem Operator oder '('
+    int i = 0;
+    while (i < normalized.size())
+    {
+        const QChar ch = normalized[i];
+        if (ch.isSpace())
+        {
+            i++;
+        }
+        else if (ch.isDigit() || ch == '.')
+        {
+            const int start = i;
+            while (i < normalized.size() && (normalized[i].isDigit() || normalized[i] == '.'))
+                i++;
+            appendCanonicalNumber(out, QStringView(normalized).mid(start, i - start));
+            operandExpected = false;
+        }
+        else
+        {
+            i++;
+            if (ch == '+' && operandExpected) // Unäres Plus trägt keine Information
+                continue;
+            out += ch;
+            operandExpected = ch != ')';
+        }
+    }
+    return out;
+}
+
+}
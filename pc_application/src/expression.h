@@ -0,0 +1,36 @@
+#ifndef EXPRESSION_H
+#define EXPRESSION_H
+
+#include <QString>
+
+// Prüfung und Aufbereitung von Eingaben, gemeinsam genutzt von der GUI und dem Batch-Modus.
+// Einfache Ausdrücke <Zahl><Operator><Zahl> rechnet das Gerät wie bisher über GetResult,
+// alles andere (Rangfolge, Klammern, unäres Minus) wird zu Bytecode übersetzt.
+namespace Expression
+{
+    enum Status
+    {
+        Valid,
+        InvalidFormat,  // Kein gültiger Ausdruck
+        DivisionByZero, // Division durch Null
+        TooComplex      // Passt nicht in Stack oder Rahmen des Geräts
+    };
+
+    // Ergebnis von parse(). Einfache Ausdrücke sind danach vollständig zerlegt und müssen
+    // weder auf dem Sendeweg noch auf dem PC ein zweites Mal gelesen werden.
+    struct Parsed
+    {
+        Status status = InvalidFormat;
+        bool simple = false; // Form <Zahl><Operator><Zahl> wie im alten Textprotokoll
+        float left = 0;      // Nur bei simple: Operanden wie atof auf dem AVR (32 Bit)
+        char op = 0;         // '+', '-', '*' oder '/'
+        float right = 0;
+    };
+
+    Parsed parse(QStringView input);           // Ein Durchlauf ohne Allokation, Kommas gelten als Dezimalpunkt
+    QString statusText(Status status);         // Fehlermeldung für die Ausgabe
+    QString normalize(const QString &input);   // Ersetzt Kommas durch Punkte, ohne Kopie, wenn es keine gibt
+    QString canonical(const QString &normalized); // Schlüssel für den Ergebnis-Cache: "01.50 + +2" -> "1.5+2"
+}
+
+#endif // EXPRESSION_H
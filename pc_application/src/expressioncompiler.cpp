@@ -0,0 +1,218 @@
+#include "expressioncompiler.h"
+#include "protocol.h"
+#include <cmath>
+
+namespace
+{
+    // Vorzeichen und Klammern zusammen; weit mehr, als Stack und Rahmen des Geräts fassen
+    constexpr int MaxNesting = Bytecode::StackSize + Protocol::MaxPayload;
+}
+
+ExpressionCompiler::ExpressionCompiler(const QString &input)
+    : input(input)
+{
+}
+
+CompiledExpression ExpressionCompiler::compile(const QString &input)
+{
+    CompiledExpression result;
+    ExpressionCompiler compiler(input);
+
+    compiler.skipSpaces();
+    if (!compiler.parseExpression())
+    {
+        if (compiler.tooDeep)
+            result.status = CompiledExpression::TooComplex;
+        return result;
+    }
+    compiler.skipSpaces();
+    if (compiler.pos != input.size())
+        return result; // Zeichen nach dem Ausdruck
+
+    if (compiler.divisionByZero)
+    {
+        result.status = CompiledExpression::DivisionByZero;
+        return result;
+    }
+    if (compiler.maxDepth > Bytecode::StackSize || compiler.code.size() > Protocol::MaxPayload)
+    {
+        result.status = CompiledExpression::TooComplex;
+        return result;
+    }
+
+    result.status = CompiledExpression::Ok;
+    result.bytecode = compiler.code;
+    result.stackDepth = compiler.maxDepth;
+    return result;
+}
+
+bool ExpressionCompiler::parseExpression()
+{
+    if (!parseTerm())
+        return false;
+    for (;;)
+    {
+        skipSpaces();
+        if (pos >= input.size() || (input[pos] != '+' && input[pos] != '-'))
+            return true;
+        const quint8 opcode = input[pos] == '+' ? Bytecode::Add : Bytecode::Sub;
+        pos++;
+        if (!parseTerm())
+            return false;
+        emitOperator(opcode);
+    }
+}
+
+bool ExpressionCompiler::parseTerm()
+{
+    if (!parseUnary())
+        return false;
+    for (;;)
+    {
+        skipSpaces();
+        if (pos >= input.size() || (input[pos] != '*' && input[pos] != '/'))
+            return true;
+        const quint8 opcode = input[pos] == '*' ? Bytecode::Mul : Bytecode::Div;
+        pos++;
+        if (!parseUnary())
+            return false;
+        if (opcode == Bytecode::Div && lastWasZeroConstant)
+            divisionByZero = true;
+        emitOperator(opcode);
+    }
+}
+
+// Vorzeichen und Klammern gehen in die Rekursion: die Tiefe wird schon beim Zerlegen
+// begrenzt, sonst sprengen 200000 "(" aus einer Batch-Datei den Stack
+bool ExpressionCompiler::parseUnary()
+{
+    skipSpaces();
+    if (pos >= input.size())
+        return false;
+    if (nesting >= MaxNesting)
+    {
+        tooDeep = true;
+        return false;
+    }
+    nesting++;
+    const bool ok = parseUnarySign();
+    nesting--;
+    return ok;
+}
+
+bool ExpressionCompiler::parseUnarySign()
+{
+    if (input[pos] == '+')
+    {
+        pos++;
+        return parseUnary();
+    }
+    if (input[pos] == '-')
+    {
+        pos++;
+        skipSpaces();
+        // Vorzeichen einer Zahl direkt in die Konstante übernehmen
+        double value;
+        const int start = pos;
+        if (parseNumber(value))
+        {
+            emitConstant(-value);
+            return true;
+        }
+        pos = start;
+        if (!parseUnary())
+            return false;
+        code.append(static_cast<char>(Bytecode::Neg));
+        lastWasZeroConstant = false;
+        return true;
+    }
+    return parsePrimary();
+}
+
+bool ExpressionCompiler::parsePrimary()
+{
+    skipSpaces();
+    if (pos < input.size() && input[pos] == '(')
+    {
+        pos++;
+        if (!parseExpression())
+            return false;
+        skipSpaces();
+        if (pos >= input.size() || input[pos] != ')')
+            return false;
+        pos++;
+        lastWasZeroConstant = false; // "(0)" wird nicht weiter ausgewertet
+        return true;
+    }
+
+    double value;
+    if (!parseNumber(value))
+        return false;
+    emitConstant(value);
+    return true;
+}
+
+// Zahl der Form 12, 12.5, .5 oder 12. (ohne Vorzeichen)
+bool ExpressionCompiler::parseNumber(double &value)
+{
+    const int start = pos;
+    bool digits = false;
+    while (pos < input.size() && input[pos].isDigit())
+    {
+        pos++;
+        digits = true;
+    }
+    if (pos < input.size() && input[pos] == '.')
+    {
+        pos++;
+        while (pos < input.size() && input[pos].isDigit())
+        {
+            pos++;
+            digits = true;
+        }
+    }
+    if (!digits)
+    {
+        pos = start;
+        return false;
+    }
+    bool ok = false;
+    value = input.mid(start, pos - start).toDouble(&ok);
+    return ok;
+}
+
+void ExpressionCompiler::skipSpaces()
+{
+    while (pos < input.size() && input[pos].isSpace())
+        pos++;
+}
+
+// Ganzzahlen in -128..127 brauchen 2 statt 5 Bytes
+void ExpressionCompiler::emitConstant(double value)
+{
+    if (value == std::floor(value) && value >= -128 && value <= 127)
+    {
+        code.append(static_cast<char>(Bytecode::PushI8));
+        code.append(static_cast<char>(static_cast<qint8>(value)));
+    }
+    else
+    {
+        code.append(static_cast<char>(Bytecode::PushF32));
+        Protocol::appendFloat(code, static_cast<float>(value)); // Der Arduino rechnet mit 32-Bit-float
+    }
+    lastWasZeroConstant = value == 0;
+    push();
+}
+
+void ExpressionCompiler::emitOperator(quint8 opcode)
+{
+    code.append(static_cast<char>(opcode));
+    depth--;
+    lastWasZeroConstant = false;
+}
+
+void ExpressionCompiler::push()
+{
+    depth++;
+    maxDepth = qMax(maxDepth, depth);
+}
@@ -0,0 +1,74 @@
+#ifndef EXPRESSIONCOMPILER_H
+#define EXPRESSIONCOMPILER_H
+
+#include <QString>
+#include <QByteArray>
+
+// Bytecode für die Stack-VM im Sketch (Postfix-Reihenfolge, Konstanten binär)
+namespace Bytecode
+{
+    constexpr quint8 PushF32 = 0x01; // + 4 Byte float (IEEE-754, little endian)
+    constexpr quint8 PushI8 = 0x02;  // + 1 Byte Ganzzahl mit Vorzeichen (-128..127)
+    constexpr quint8 Add = 0x10;
+    constexpr quint8 Sub = 0x11;
+    constexpr quint8 Mul = 0x12;
+    constexpr quint8 Div = 0x13;
+    constexpr quint8 Neg = 0x14;
+
+    constexpr int StackSize = 16; // Stacktiefe der VM auf dem Arduino
+}
+
+struct CompiledExpression
+{
+    enum Status
+    {
+        Ok,
+        SyntaxError,    // Ungültige Eingabe
+        DivisionByZero, // Division durch eine Konstante 0
+        TooComplex      // Stack oder Rahmen des Geräts reichen nicht aus
+    };
+
+    Status status = SyntaxError;
+    QByteArray bytecode; // Programm für die VM
+    int stackDepth = 0;  // Maximale Stacktiefe beim Ausführen
+};
+
+// Übersetzt Ausdrücke mit + - * /, Klammern und unärem Minus in kompakten
+// Postfix-Bytecode. Die Rangfolge wird einmal auf dem PC aufgelöst, der
+// Arduino arbeitet das Programm nur noch in einer Schleife ab.
+//
+//   expr    := term (('+' | '-') term)*
+//   term    := unary (('*' | '/') unary)*
+//   unary   := ('-' | '+') unary | primary
+//   primary := number | '(' expr ')'
+class ExpressionCompiler
+{
+public:
+    static CompiledExpression compile(const QString &input); // Kommas müssen bereits durch Punkte ersetzt sein
+
+private:
+    explicit ExpressionCompiler(const QString &input);
+
+    bool parseExpression();
+    bool parseTerm();
+    bool parseUnary();     // Begrenzt die Verschachtelung, dann parseUnarySign()
+    bool parseUnarySign();
+    bool parsePrimary();
+    bool parseNumber(double &value);
+    void skipSpaces();
+    void emitConstant(double value);
+    void emitOperator(quint8 opcode); // Verbraucht zwei Stackeinträge, erzeugt einen
+    void push();                       // Führt die Stacktiefe mit
+
+    const QString &input;
+    int pos = 0;
+    int depth = 0;
+    int maxDepth = 0;
+    int nesting = 0;       // Aktuelle Rekursionstiefe von parseUnary()
+    bool tooDeep = false;  // Zu tief verschachtelt, siehe parseUnary()
+    bool divisionByZero = false;
+    bool lastWasZeroConstant = false;
+    QByteArray code;
+};
+
+#endif // EXPRESSIONCOMPILER_H
@@ -0,0 +1,187 @@
+#include "hostevaluator.h"
+#include "expression.h"
+#include "expressioncompiler.h"
+#include "protocol.h"
+#include <QtEndian>
+#include <cmath>
+#include <cstring>
+
+namespace HostEvaluator
+{
+
+// Wie atof: führende Leerzeichen überspringen und nur den gültigen Anfang umwandeln
+static float atofPrefix(const QString &text)
+{
+    int start = 0;
+    while (start < text.size() && text[start].isSpace())
+        start++;
+    int end = start;
+    if (end < text.size() && (text[end] == '+' || text[end] == '-'))
+        end++;
+    while (end < text.size() && text[end].isDigit())
+        end++;
+    if (end < text.size() && text[end] == '.')
+    {
+        end++;
+        while (end < text.size() && text[end].isDigit())
+            end++;
+    }
+    return static_cast<float>(text.mid(start, end - start).toDouble()); // Ungültig ergibt 0 wie atof
+}
+
+// Wie Calculate() im Sketch: Operator ab Index 1 suchen, beide Seiten wie atof umwandeln
+QString getResult(const QString &input)
+{
+    int operatorIndex = -1;
+    for (int i = 1; i < input.size(); i++)
+    {
+        const QChar ch = input[i];
+        if (ch == '+' || ch == '-' || ch == '*' || ch == '/')
+        {
+            operatorIndex = i;
+            break;
+        }
+    }
+    if (operatorIndex < 0)
+        return Protocol::errorText(Protocol::ErrNoOperator);
+
+    // avr-libc liefert bei atof direkt einen float
+    const float num1 = atofPrefix(input.left(operatorIndex));
+    const float num2 = atofPrefix(input.mid(operatorIndex + 1));
+    return calculate(num1, input[operatorIndex].toLatin1(), num2);
+}
+
+QString calculate(float num1, char op, float num2)
+{
+    float result = 0;
+    switch (op)
+    {
+    case '+':
+        result = num1 + num2;
+        break;
+    case '-':
+        result = num1 - num2;
+        break;
+    case '*':
+        result = num1 * num2;
+        break;
+    case '/':
+        if (num2 == 0)
+            return Protocol::errorText(Protocol::ErrDivByZero);
+        result = num1 / num2;
+        break;
+    }
+    return formatResult(result);
+}
+
+QString evaluate(const QString &normalized)
+{
+    return evaluate(normalized, Expression::parse(normalized));
+}
+
+QString evaluate(const QString &normalized, const Expression::Parsed &parsed)
+{
+    if (parsed.simple) // Operanden sind schon wie von atof umgewandelt
+        return calculate(parsed.left, parsed.op, parsed.right);
+
+    const CompiledExpression compiled = ExpressionCompiler::compile(normalized);
+    if (compiled.status == CompiledExpression::DivisionByZero)
+        return Protocol::errorText(Protocol::ErrDivByZero);
+    if (compiled.status != CompiledExpression::Ok)
+        return Protocol::errorText(Protocol::ErrBadPayload);
+
+    float result;
+    quint8 error;
+    if (!runBytecode(compiled.bytecode, result, error))
+        return Protocol::errorText(error);
+    return formatResult(result);
+}
+
+// dtostrf auf dem AVR erzeugt höchstens 7 signifikante Stellen und füllt den Rest mit
+// Nullen auf; "inf" und "nan" werden klein geschrieben.
+QString formatResult(float result)
+{
+    if (std::isnan(result))
+        return "nan";
+    const QString sign = std::signbit(result) ? "-" : "";
+    const double magnitude = std::fabs(static_cast<double>(result));
+    if (std::isinf(magnitude))
+        return sign + "inf";
+    if (magnitude == 0)
+        return sign + "0.0000";
+
+    const int exponent = static_cast<int>(std::floor(std::log10(magnitude)));
+    const int digits = exponent + 1 + Protocol::DecimalPlaces; // Benötigte signifikante Stellen
+    if (digits <= 7)
+        return sign + QString::number(magnitude, 'f', Protocol::DecimalPlaces);
+
+    const double rounded = QString::number(magnitude, 'e', 6).toDouble(); // Auf 7 Stellen runden
+    return sign + QString::number(rounded, 'f', Protocol::DecimalPlaces);
+}
+
+bool runBytecode(const QByteArray &code, float &result, quint8 &error)
+{
+    float stack[Bytecode::StackSize];
+    int sp = 0;
+    int pc = 0;
+    error = Protocol::ErrBadBytecode;
+    while (pc < code.size())
+    {
+        const quint8 op = static_cast<quint8>(code[pc++]);
+        if (op == Bytecode::PushF32)
+        {
+            if (sp >= Bytecode::StackSize || pc + 4 > code.size())
+                return false;
+            const quint32 bits = qFromLittleEndian<quint32>(code.constData() + pc);
+            memcpy(&stack[sp++], &bits, sizeof(float));
+            pc += 4;
+        }
+        else if (op == Bytecode::PushI8)
+        {
+            if (sp >= Bytecode::StackSize || pc + 1 > code.size())
+                return false;
+            stack[sp++] = static_cast<qint8>(code[pc++]);
+        }
+        else if (op == Bytecode::Neg)
+        {
+            if (sp < 1)
+                return false;
+            stack[sp - 1] = -stack[sp - 1];
+        }
+        else
+        {
+            if (sp < 2)
+                return false;
+            const float b = stack[--sp];
+            float &a = stack[sp - 1];
+            switch (op)
+            {
+            case Bytecode::Add:
+                a = a + b;
+                break;
+            case Bytecode::Sub:
+                a = a - b;
+                break;
+            case Bytecode::Mul:
+                a = a * b;
+                break;
+            case Bytecode::Div:
+                if (b == 0)
+                {
+                    error = Protocol::ErrDivByZero;
+                    return false;
+                }
+                a = a / b;
+                break;
+            default:
+                return false;
+            }
+        }
+    }
+    if (sp != 1)
+        return false;
+    result = stack[0];
+    return true;
+}
+
+}
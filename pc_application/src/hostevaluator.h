@@ -0,0 +1,22 @@
+#ifndef HOSTEVALUATOR_H
+#define HOSTEVALUATOR_H
+
+#include <QString>
+#include <QByteArray>
+#include "expression.h"
+
+// Rechnet auf dem PC mit denselben Ergebnissen wie der Sketch: 32-Bit-float wie der
+// double des AVR, dieselbe Zerlegung wie Calculate()/RunBytecode() und dieselbe
+// Ausgabe wie dtostrf(result, 6, 4). Wird genutzt, wenn das Gerät ausgelastet oder
+// nicht erreichbar ist.
+namespace HostEvaluator
+{
+    QString evaluate(const QString &normalized);         // Antwort wie vom Gerät, z.B. "15.5000" oder "Error: divison by 0"
+    QString evaluate(const QString &normalized, const Expression::Parsed &parsed); // Ohne erneutes Zerlegen
+    QString getResult(const QString &input);             // Wie GetResult() im Sketch, auch für ungültige Eingaben
+    QString calculate(float num1, char op, float num2);  // Wie Calculate() im Sketch nach dem Zerlegen
+    QString formatResult(float result);                  // Wie dtostrf(result, 6, 4), ohne führende Leerzeichen
+    bool runBytecode(const QByteArray &code, float &result, quint8 &error); // Wie RunBytecode() im Sketch
+}
+
+#endif // HOSTEVALUATOR_H
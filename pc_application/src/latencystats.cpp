@@ -0,0 +1,138 @@
+#include "latencystats.h"
+#include <QTextStream>
+#include <algorithm>
+#include <cmath>
+
+LatencyHistogram::LatencyHistogram()
+    : counts(2 * SubBucketHalf + MaxExponent * SubBucketHalf, 0)
+{
+}
+
+// Werte < 128 landen direkt in ihrer Klasse, größere in eine von 64 Klassen ihrer Zweierpotenz
+int LatencyHistogram::indexOf(qint64 value)
+{
+    if (value < 2 * SubBucketHalf)
+        return static_cast<int>(qMax<qint64>(0, value));
+    int msb = 63;
+    while (!(value >> msb))
+        msb--;
+    const int exponent = qMin(msb - (SubBucketBits - 1), MaxExponent);
+    const qint64 sub = qMin<qint64>(value >> exponent, 2 * SubBucketHalf - 1);
+    return 2 * SubBucketHalf + (exponent - 1) * SubBucketHalf + static_cast<int>(sub - SubBucketHalf);
+}
+
+qint64 LatencyHistogram::highestEquivalent(int index)
+{
+    if (index < 2 * SubBucketHalf)
+        return index;
+    const int exponent = (index - 2 * SubBucketHalf) / SubBucketHalf + 1;
+    const qint64 sub = (index - 2 * SubBucketHalf) % SubBucketHalf + SubBucketHalf;
+    return ((sub + 1) << exponent) - 1;
+}
+
+void LatencyHistogram::record(qint64 valueUs)
+{
+    valueUs = qMax<qint64>(0, valueUs);
+    counts[indexOf(valueUs)]++;
+    minValue = total ? qMin(minValue, valueUs) : valueUs;
+    maxValue = qMax(maxValue, valueUs);
+    sum += valueUs;
+    total++;
+}
+
+void LatencyHistogram::clear()
+{
+    std::fill(counts.begin(), counts.end(), 0);
+    total = 0;
+    minValue = 0;
+    maxValue = 0;
+    sum = 0;
+}
+
+qint64 LatencyHistogram::percentile(double p) const
+{
+    if (total == 0)
+        return 0;
+    const quint64 target = qMax<quint64>(1, static_cast<quint64>(std::ceil(p / 100.0 * total)));
+    quint64 seen = 0;
+    for (int i = 0; i < static_cast<int>(counts.size()); i++)
+    {
+        seen += counts[i];
+        if (seen >= target)
+            return qMin(highestEquivalent(i), maxValue);
+    }
+    return maxValue;
+}
+
+void LatencyStats::record(const StageTimes &times)
+{
+    add(Validate, times.validatedAt, times.queuedAt);
+    add(Queue, times.queuedAt, times.writtenAt);
+    add(Flush, times.writtenAt, times.flushedAt);
+    add(Device, times.flushedAt >= 0 ? times.flushedAt : times.writtenAt, times.firstByteAt);
+    add(Receive, times.firstByteAt, times.completedAt);
+    add(Total, times.validatedAt >= 0 ? times.validatedAt : times.queuedAt, times.completedAt);
+}
+
+// Nur Stufen, deren beide Zeitpunkte bekannt sind
+void LatencyStats::add(Stage stage, qint64 from, qint64 to)
+{
+    if (from >= 0 && to >= from)
+        histograms[stage].record((to - from) / 1000);
+}
+
+void LatencyStats::clear()
+{
+    for (LatencyHistogram &histogram : histograms)
+        histogram.clear();
+}
+
+QString LatencyStats::stageName(Stage stage)
+{
+    switch (stage)
+    {
+    case Validate:
+        return "validate";
+    case Queue:
+        return "queue";
+    case Flush:
+        return "flush";
+    case Device:
+        return "device";
+    case Receive:
+        return "receive";
+    case Total:
+        return "total";
+    default:
+        return QString();
+    }
+}
+
+QStringList LatencyStats::columns()
+{
+    return {"stage", "count", "min_us", "mean_us", "p50_us", "p90_us", "p99_us", "p999_us", "max_us"};
+}
+
+QStringList LatencyStats::row(Stage stage) const
+{
+    const LatencyHistogram &h = histograms[stage];
+    return {stageName(stage),
+            QString::number(h.count()),
+            QString::number(h.min()),
+            QString::number(h.mean(), 'f', 1),
+            QString::number(h.percentile(50)),
+            QString::number(h.percentile(90)),
+            QString::number(h.percentile(99)),
+            QString::number(h.percentile(99.9)),
+            QString::number(h.max())};
+}
+
+bool LatencyStats::exportCsv(QIODevice *device) const
+{
+    QTextStream out(device);
+    out << columns().join(',') << '\n';
+    for (int stage = 0; stage < StageCount; stage++)
+        out << row(static_cast<Stage>(stage)).join(',') << '\n';
+    out.flush();
+    return out.status() == QTextStream::Ok;
+}
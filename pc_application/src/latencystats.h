@@ -0,0 +1,80 @@
+#ifndef LATENCYSTATS_H
+#define LATENCYSTATS_H
+
+#include <QString>
+#include <QStringList>
+#include <QIODevice>
+#include <vector>
+
+// Zeitpunkte einer Anfrage in ns auf der monotonen Uhr der RequestEngine, -1: Stufe nicht durchlaufen
+// (z.B. Cache-Treffer oder Rechnung auf dem PC werden nie gesendet)
+struct StageTimes
+{
+    qint64 validatedAt = -1; // Vor check_input
+    qint64 queuedAt = -1;    // enqueue()
+    qint64 writtenAt = -1;   // serial->write() der ersten Übertragung
+    qint64 flushedAt = -1;   // bytesWritten: alle Bytes beim Treiber abgegeben
+    qint64 firstByteAt = -1; // Erstes Byte der Antwort empfangen
+    qint64 completedAt = -1; // Antwort vollständig und zugeordnet
+};
+
+// Histogramm nach dem Vorbild von HdrHistogram: bis 127 µs exakt, darüber 64 Klassen pro
+// Zweierpotenz (Fehler < 1,6 %). Feste Größe, record() kostet nur ein paar Shifts.
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    void record(qint64 valueUs);
+    void clear();
+    quint64 count() const { return total; }
+    qint64 min() const { return total ? minValue : 0; }
+    qint64 max() const { return maxValue; }
+    double mean() const { return total ? static_cast<double>(sum) / total : 0.0; }
+    qint64 percentile(double p) const; // Obergrenze der Klasse, in der das p-Perzentil liegt
+
+private:
+    static int indexOf(qint64 value);
+    static qint64 highestEquivalent(int index);
+
+    std::vector<quint64> counts;
+    quint64 total = 0;
+    qint64 minValue = 0;
+    qint64 maxValue = 0;
+    qint64 sum = 0;
+
+    static constexpr int SubBucketBits = 7;                      // 128 exakte Werte
+    static constexpr int SubBucketHalf = 1 << (SubBucketBits - 1); // 64 Klassen pro Zweierpotenz
+    static constexpr int MaxExponent = 30;                       // Bis ca. 2^37 µs
+};
+
+// Histogramme je Stufe einer Anfrage
+class LatencyStats
+{
+public:
+    enum Stage
+    {
+        Validate, // validatedAt -> queuedAt
+        Queue,    // queuedAt -> writtenAt: Warten auf Platz im Fenster
+        Flush,    // writtenAt -> flushedAt: Bytes an den Treiber
+        Device,   // flushedAt -> firstByteAt: Übertragung, Rechnung und Rückweg bis zum ersten Byte
+        Receive,  // firstByteAt -> completedAt: Rest der Antwort
+        Total,    // validatedAt (oder queuedAt) -> completedAt
+        StageCount
+    };
+
+    void record(const StageTimes &times);
+    void clear();
+    const LatencyHistogram &histogram(Stage stage) const { return histograms[stage]; }
+    static QString stageName(Stage stage);
+    static QStringList columns();           // Spaltennamen für Tabelle und CSV
+    QStringList row(Stage stage) const;     // Werte in µs passend zu columns()
+    bool exportCsv(QIODevice *device) const;
+
+private:
+    void add(Stage stage, qint64 from, qint64 to);
+
+    LatencyHistogram histograms[StageCount];
+};
+
+#endif // LATENCYSTATS_H
@@ -0,0 +1,80 @@
+#include "linkmonitor.h"
+
+LinkMonitor::LinkMonitor(QSerialPort *serial, RequestEngine *engine, QObject *parent)
+    : QObject(parent), serial(serial), engine(engine), heartbeatTimer(new QTimer(this))
+{
+    heartbeatTimer->setInterval(HeartbeatIntervalMs);
+
+    connect(serial, &QSerialPort::errorOccurred, this, &LinkMonitor::onErrorOccurred);
+    connect(serial, &QSerialPort::readyRead, this, &LinkMonitor::onTraffic);
+    connect(heartbeatTimer, &QTimer::timeout, this, &LinkMonitor::onHeartbeatTick);
+}
+
+void LinkMonitor::start()
+{
+    lastTraffic.start();
+    heartbeatTimer->start();
+    setAlive(serial->isOpen());
+}
+
+void LinkMonitor::stop()
+{
+    heartbeatTimer->stop();
+    setAlive(false);
+}
+
+bool LinkMonitor::isAlive() const
+{
+    return alive;
+}
+
+void LinkMonitor::onErrorOccurred(QSerialPort::SerialPortError error)
+{
+    switch (error)
+    {
+    case QSerialPort::ResourceError:     // USB-Kabel gezogen
+    case QSerialPort::DeviceNotFoundError:
+    case QSerialPort::PermissionError:
+    case QSerialPort::ReadError:
+    case QSerialPort::WriteError:
+        stop();
+        break;
+    default:
+        break;
+    }
+}
+
+void LinkMonitor::onTraffic()
+{
+    lastTraffic.restart();
+    if (heartbeatTimer->isActive())
+        setAlive(true);
+}
+
+// Läuft einmal pro Sekunde: solange Antworten eintreffen, wird nichts gesendet
+void LinkMonitor::onHeartbeatTick()
+{
+    if (!serial->isOpen())
+    {
+        stop();
+        return;
+    }
+
+    // Das alte Textprotokoll kennt keinen Heartbeat, dort zählen nur Portfehler
+    if (engine->wireMode() != RequestEngine::Framed)
+        return;
+
+    // Auch nach einem Timeout weiter pingen, damit sich die Verbindung erholen kann
+    if (lastTraffic.elapsed() >= HeartbeatIntervalMs && !engine->isBusy())
+        engine->sendCommand(Protocol::OpPing);
+    if (lastTraffic.elapsed() >= LinkTimeoutMs)
+        setAlive(false);
+}
+
+void LinkMonitor::setAlive(bool alive)
+{
+    if (this->alive == alive)
+        return;
+    this->alive = alive;
+    emit connectionStatusChanged(alive);
+}
@@ -0,0 +1,45 @@
+#ifndef LINKMONITOR_H
+#define LINKMONITOR_H
+
+#include <QObject>
+#include <QSerialPort>
+#include <QTimer>
+#include <QElapsedTimer>
+#include "requestengine.h"
+
+// Ereignisgesteuerte Verbindungsüberwachung: wertet Fehler des seriellen Ports und
+// den normalen Datenverkehr aus und schickt nur in Ruhephasen einen Heartbeat.
+// Liest selbst keine Bytes und meldet den Status nur bei einer echten Änderung.
+class LinkMonitor : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LinkMonitor(QSerialPort *serial, RequestEngine *engine, QObject *parent = nullptr);
+
+    void start();          // Nach dem Öffnen des Ports aufrufen
+    void stop();           // Nach dem Schließen des Ports aufrufen
+    bool isAlive() const;  // Letzter gemeldeter Status
+
+signals:
+    void connectionStatusChanged(bool isConnected); // Nur bei einer Änderung des Status
+
+private slots:
+    void onErrorOccurred(QSerialPort::SerialPortError error); // Gerät entfernt, Lese-/Schreibfehler
+    void onTraffic();                                         // Jedes empfangene Byte zeigt, dass das Gerät lebt
+    void onHeartbeatTick();                                   // Heartbeat senden oder Verbindung als verloren melden
+
+private:
+    void setAlive(bool alive);
+
+    QSerialPort *serial;
+    RequestEngine *engine;
+    QTimer *heartbeatTimer;   // Niedrige Rate, läuft nur bei offener Verbindung
+    QElapsedTimer lastTraffic; // Zeit seit dem letzten empfangenen Byte
+    bool alive = false;
+
+    static constexpr int HeartbeatIntervalMs = 1000; // Heartbeat nach so langer Ruhe
+    static constexpr int LinkTimeoutMs = 3500;       // Ohne empfangene Bytes gilt die Verbindung als verloren
+};
+
+#endif // LINKMONITOR_H
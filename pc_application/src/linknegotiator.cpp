@@ -0,0 +1,222 @@
+#include "linknegotiator.h"
+#include <QTimer>
+
+LinkNegotiator::LinkNegotiator(QSerialPort *serial, RequestEngine *engine, QObject *parent)
+    : QObject(parent), serial(serial), engine(engine)
+{
+    connect(engine, &RequestEngine::commandReplied, this, &LinkNegotiator::onCommandReplied);
+    connect(engine, &RequestEngine::commandFailed, this, &LinkNegotiator::onCommandFailed);
+}
+
+void LinkNegotiator::setMaxBaudRate(qint32 baudRate)
+{
+    maxBaudRate = baudRate;
+}
+
+void LinkNegotiator::start(int startDelayMs)
+{
+    cancel();
+    info = Protocol::DeviceInfo();
+    helloAttempts = 0;
+    engine->setWireMode(RequestEngine::Framed);
+
+    const int current = generation;
+    QTimer::singleShot(startDelayMs, this, [this, current]() {
+        if (current == generation)
+            sendHello();
+    });
+}
+
+void LinkNegotiator::cancel()
+{
+    generation++;
+    state = Idle;
+    pendingId = 0;
+}
+
+const Protocol::DeviceInfo &LinkNegotiator::deviceInfo() const
+{
+    return info;
+}
+
+void LinkNegotiator::sendHello()
+{
+    state = Hello;
+    helloAttempts++;
+    pendingId = engine->sendCommand(Protocol::OpHello);
+}
+
+void LinkNegotiator::onCommandReplied(quint32 id, quint8 opcode, const QByteArray &payload)
+{
+    if (state == Idle || id != pendingId)
+        return;
+
+    switch (state)
+    {
+    case Hello:
+    {
+        if (opcode != Protocol::OpHelloReply || payload.size() < 4)
+        {
+            complete(false);
+            return;
+        }
+        info.version = static_cast<quint8>(payload[0]);
+        info.features = static_cast<quint16>(static_cast<quint8>(payload[1]) | (static_cast<quint8>(payload[2]) << 8));
+        info.baudMask = static_cast<quint8>(payload[3]);
+
+        candidates.clear();
+        if (info.has(Protocol::FeatureBaudRate))
+        {
+            for (int i = Protocol::BaudRateCount - 1; i > 0; i--)
+            {
+                if ((info.baudMask & (1 << i)) && Protocol::BaudRates[i] <= maxBaudRate)
+                    candidates.append(i);
+            }
+        }
+        tryNextBaudRate();
+        break;
+    }
+    case SetBaud:
+        if (opcode == Protocol::OpAck)
+        {
+            // Das Gerät stellt nach dem Senden des Acks um, kurz warten und nachziehen
+            const int current = generation;
+            QTimer::singleShot(SwitchDelayMs, this, [this, current]() {
+                if (current == generation)
+                    switchHostBaudRate();
+            });
+        }
+        else
+        {
+            complete(true); // Gerät lehnt ab: bei 9600 bleiben
+        }
+        break;
+    case Echo:
+        if (opcode == Protocol::OpEchoReply && payload == echoPattern())
+        {
+            commitAttempts = 0;
+            sendCommit();
+        }
+        else
+        {
+            fallBack();
+        }
+        break;
+    case Commit:
+        if (opcode == Protocol::OpAck)
+            complete(true);
+        else
+            fallBack(); // Gerät kennt OpCommitBaud nicht und fällt selbst zurück
+        break;
+    default:
+        break;
+    }
+}
+
+void LinkNegotiator::onCommandFailed(quint32 id, const QString &reason)
+{
+    Q_UNUSED(reason);
+    if (state == Idle || id != pendingId)
+        return;
+
+    switch (state)
+    {
+    case Hello:
+        if (helloAttempts < MaxHelloAttempts)
+        {
+            sendHello();
+        }
+        else
+        {
+            // Alte Firmware: angefangene "Zeile" aus Rahmenbytes mit einem Newline abschließen
+            // und die Fehlermeldung dazu verwerfen
+            engine->setWireMode(RequestEngine::TextLines);
+            serial->write("\n");
+            state = Revert;
+            const int current = generation;
+            QTimer::singleShot(200, this, [this, current]() {
+                if (current != generation)
+                    return;
+                serial->clear(QSerialPort::Input);
+                engine->discardInput();
+                complete(false);
+            });
+        }
+        break;
+    case SetBaud:
+        complete(true);
+        break;
+    case Echo:
+        fallBack();
+        break;
+    case Commit:
+        // Rahmen oder Ack verloren: Jeder gültige Rahmen verlängert die Probezeit des
+        // Geräts, eine Wiederholung mit der neuen Rate ist also noch möglich
+        if (commitAttempts < MaxCommitAttempts)
+            sendCommit();
+        else
+            fallBack();
+        break;
+    default:
+        break;
+    }
+}
+
+// Versucht die nächste (niedrigere) Rate; ohne weitere Kandidaten bleibt es bei 9600
+void LinkNegotiator::tryNextBaudRate()
+{
+    if (candidates.isEmpty())
+    {
+        complete(true);
+        return;
+    }
+    currentIndex = candidates.takeFirst();
+    state = SetBaud;
+    pendingId = engine->sendCommand(Protocol::OpSetBaud, QByteArray(1, static_cast<char>(currentIndex)));
+}
+
+void LinkNegotiator::switchHostBaudRate()
+{
+    serial->setBaudRate(Protocol::BaudRates[currentIndex]);
+    serial->clear(QSerialPort::Input);
+    engine->discardInput();
+    state = Echo;
+    pendingId = engine->sendCommand(Protocol::OpEcho, echoPattern());
+}
+
+void LinkNegotiator::sendCommit()
+{
+    state = Commit;
+    commitAttempts++;
+    pendingId = engine->sendCommand(Protocol::OpCommitBaud);
+}
+
+// Die neue Rate ist unzuverlässig: das Gerät fällt nach der Probezeit selbst auf
+// 9600 zurück, danach wird die nächstniedrigere Rate versucht
+void LinkNegotiator::fallBack()
+{
+    serial->setBaudRate(Protocol::DefaultBaudRate);
+    state = Revert;
+    const int current = generation;
+    QTimer::singleShot(DeviceProbationMs + 100, this, [this, current]() {
+        if (current != generation)
+            return;
+        serial->clear(QSerialPort::Input);
+        engine->discardInput();
+        tryNextBaudRate();
+    });
+}
+
+void LinkNegotiator::complete(bool framed)
+{
+    state = Idle;
+    pendingId = 0;
+    emit finished(framed, serial->baudRate());
+}
+
+// Wechselnde Bitmuster und das Sync-Byte, damit Abtastfehler sicher auffallen
+QByteArray LinkNegotiator::echoPattern()
+{
+    static const char pattern[] = {'\x55', '\xAA', '\x00', '\xFF', '\xA5', '\x5A', '\x0F', '\xF0'};
+    return QByteArray(pattern, sizeof(pattern));
+}
@@ -0,0 +1,71 @@
+#ifndef LINKNEGOTIATOR_H
+#define LINKNEGOTIATOR_H
+
+#include <QObject>
+#include <QSerialPort>
+#include <QList>
+#include "requestengine.h"
+#include "protocol.h"
+
+// Handshake nach dem Verbinden: fragt Version und Fähigkeiten des Geräts ab und
+// handelt die höchste zuverlässige Baudrate aus. Jede neue Rate wird mit einem
+// Echo-Test geprüft und danach per OpCommitBaud festgeschrieben, sonst fallen beide
+// Seiten auf 9600 Baud zurück. Erst OpCommitBaud beendet die Probezeit des Geräts:
+// Geht die Echo-Antwort verloren, kehrt es so sicher zur Startrate zurück.
+class LinkNegotiator : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LinkNegotiator(QSerialPort *serial, RequestEngine *engine, QObject *parent = nullptr);
+
+    void setMaxBaudRate(qint32 baudRate);  // Obergrenze für die Aushandlung
+    void start(int startDelayMs = 0);      // Startet den Handshake (Verzögerung für den Reset des Arduino)
+    void cancel();                         // Bricht einen laufenden Handshake ab
+    const Protocol::DeviceInfo &deviceInfo() const;
+
+signals:
+    void finished(bool framed, qint32 baudRate); // framed=false: alte Firmware, Textprotokoll
+
+private slots:
+    void onCommandReplied(quint32 id, quint8 opcode, const QByteArray &payload);
+    void onCommandFailed(quint32 id, const QString &reason);
+
+private:
+    enum State
+    {
+        Idle,
+        Hello,   // Warte auf OpHelloReply
+        SetBaud, // Warte auf OpAck (noch alte Rate)
+        Echo,    // Warte auf OpEchoReply (neue Rate)
+        Commit,  // Warte auf OpAck zu OpCommitBaud (neue Rate)
+        Revert   // Warte, bis das Gerät selbst auf 9600 zurückgefallen ist
+    };
+
+    void sendHello();
+    void tryNextBaudRate();      // Nächstniedrigere Rate versuchen oder mit der aktuellen abschließen
+    void switchHostBaudRate();   // Nach OpAck: eigene Rate umstellen und Echo senden
+    void sendCommit();           // Nach dem Echo: neue Rate beim Gerät festschreiben
+    void fallBack();             // Echo oder Festschreiben fehlgeschlagen: zurück auf 9600
+    void complete(bool framed);
+    static QByteArray echoPattern();
+
+    QSerialPort *serial;
+    RequestEngine *engine;
+    State state = Idle;
+    quint32 pendingId = 0;        // ID des erwarteten Steuerrahmens
+    int helloAttempts = 0;        // Der Arduino startet nach dem Öffnen neu und antwortet erst danach
+    int commitAttempts = 0;       // OpCommitBaud ist wiederholbar, falls das Ack verloren geht
+    int generation = 0;           // Macht verspätete Timer nach cancel() wirkungslos
+    QList<int> candidates;        // Noch zu testende Indizes in BaudRates, absteigend
+    int currentIndex = 0;         // Gerade getestete Rate
+    qint32 maxBaudRate = 1000000;
+    Protocol::DeviceInfo info;
+
+    static constexpr int MaxHelloAttempts = 3;
+    static constexpr int MaxCommitAttempts = 3;
+    static constexpr int SwitchDelayMs = 20;     // Zeit für das Gerät, die Rate umzustellen
+    static constexpr int DeviceProbationMs = 2000; // Gerät fällt so lange nach dem letzten gültigen Rahmen ohne OpCommitBaud zurück
+};
+
+#endif // LINKNEGOTIATOR_H
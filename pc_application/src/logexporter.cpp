@@ -0,0 +1,117 @@
+#include "logexporter.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QtEndian>
+
+LogExporter::LogExporter(const LogModel::Snapshot &snapshot, const QString &fileName, Format format)
+    : snapshot(snapshot), fileName(fileName), format(format)
+{
+}
+
+LogExporter::Format LogExporter::formatForFile(const QString &fileName)
+{
+    const QString suffix = QFileInfo(fileName).suffix().toLower();
+    if (suffix == "csv")
+        return Csv;
+    if (suffix == "clog")
+        return Binary;
+    return Text;
+}
+
+void LogExporter::cancel()
+{
+    cancelled.store(true, std::memory_order_relaxed);
+}
+
+void LogExporter::run()
+{
+    QFile file(fileName);
+    const QIODevice::OpenMode mode = format == Binary ? QIODevice::WriteOnly : QIODevice::WriteOnly | QIODevice::Text;
+    if (!file.open(mode))
+    {
+        emit finished(false, file.errorString());
+        return;
+    }
+
+    const int total = snapshot.size();
+    QByteArray chunk;
+    chunk.reserve(ChunkBytes + 4096);
+    if (format == Csv)
+        chunk += "timestamp_ms,kind,request_id,message\n";
+    else if (format == Binary)
+        chunk += QByteArray("CLOG\x01", 5);
+
+    for (int row = 0; row < total; row++)
+    {
+        appendRecord(chunk, snapshot.at(row));
+        if (chunk.size() >= ChunkBytes)
+        {
+            if (file.write(chunk) != chunk.size())
+                break;
+            chunk.clear(); // Kapazität bleibt erhalten
+        }
+        if ((row + 1) % ProgressStep == 0)
+        {
+            if (cancelled.load(std::memory_order_relaxed))
+                break;
+            emit progress(row + 1, total);
+        }
+    }
+
+    const bool cancel = cancelled.load(std::memory_order_relaxed);
+    const bool ok = !cancel && file.error() == QFileDevice::NoError && file.write(chunk) == chunk.size();
+    const QString error = cancel ? QString("Export cancelled.") : file.errorString();
+    file.close();
+    if (!ok)
+    {
+        file.remove(); // Keine halbe Datei zurücklassen
+        emit finished(false, error);
+        return;
+    }
+    emit progress(total, total);
+    emit finished(true, QString());
+}
+
+void LogExporter::appendRecord(QByteArray &chunk, const LogModel::Entry &entry) const
+{
+    switch (format)
+    {
+    case Text:
+        chunk += LogModel::format(entry).toUtf8();
+        chunk += '\n';
+        break;
+    case Csv:
+        chunk += QByteArray::number(entry.timestamp);
+        chunk += ',';
+        chunk += LogModel::kindLabel(entry.kind).toLatin1();
+        chunk += ',';
+        if (entry.requestId != 0)
+            chunk += QByteArray::number(entry.requestId);
+        chunk += ',';
+        chunk += csvField(entry.payload);
+        chunk += '\n';
+        break;
+    case Binary:
+    {
+        const QByteArray payload = entry.payload.toUtf8();
+        char header[17];
+        qToLittleEndian<qint64>(entry.timestamp, header);
+        header[8] = static_cast<char>(entry.kind);
+        qToLittleEndian<quint32>(entry.requestId, header + 9);
+        qToLittleEndian<quint32>(static_cast<quint32>(payload.size()), header + 13);
+        chunk.append(header, sizeof(header));
+        chunk += payload;
+        break;
+    }
+    }
+}
+
+QByteArray LogExporter::csvField(const QString &field)
+{
+    const QByteArray utf8 = field.toUtf8();
+    if (!utf8.contains(',') && !utf8.contains('"') && !utf8.contains('\n'))
+        return utf8;
+    QByteArray quoted = utf8;
+    quoted.replace('"', "\"\"");
+    return '"' + quoted + '"';
+}
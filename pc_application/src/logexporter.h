@@ -0,0 +1,52 @@
+#ifndef LOGEXPORTER_H
+#define LOGEXPORTER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <atomic>
+#include "logmodel.h"
+
+// Schreibt eine Momentaufnahme des Logs in einem eigenen Thread. Die Einträge werden
+// blockweise formatiert und geschrieben, der Speicherbedarf hängt also nicht von der
+// Länge des Logs ab.
+//
+// Binärformat (.clog, little endian): "CLOG" + Version (1 Byte), danach je Eintrag
+// Zeitstempel ms (8), Art (1), Anfrage-ID (4), Länge (4), Text als UTF-8.
+class LogExporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Format
+    {
+        Text,  // Wie in der Ansicht
+        Csv,   // timestamp_ms,kind,request_id,message
+        Binary // Siehe oben, am kompaktesten und am schnellsten
+    };
+
+    LogExporter(const LogModel::Snapshot &snapshot, const QString &fileName, Format format);
+
+    static Format formatForFile(const QString &fileName); // Nach Dateiendung, sonst Text
+    void cancel();                                         // Aus jedem Thread aufrufbar
+
+public slots:
+    void run(); // Läuft im Export-Thread
+
+signals:
+    void progress(int done, int total);
+    void finished(bool ok, const QString &error);
+
+private:
+    void appendRecord(QByteArray &chunk, const LogModel::Entry &entry) const;
+    static QByteArray csvField(const QString &field);
+
+    const LogModel::Snapshot snapshot;
+    const QString fileName;
+    const Format format;
+    std::atomic<bool> cancelled{false};
+
+    static constexpr int ChunkBytes = 256 * 1024; // Blockgröße pro write()
+    static constexpr int ProgressStep = 8192;     // Einträge zwischen zwei progress()-Signalen
+};
+
+#endif // LOGEXPORTER_H
@@ -0,0 +1,122 @@
+#include "logmodel.h"
+#include <QBrush>
+#include <QDateTime>
+
+LogModel::LogModel(int capacity, QObject *parent)
+    : QAbstractListModel(parent), maxEntries(qMax(1, capacity))
+{
+}
+
+void LogModel::append(Kind kind, const QString &payload, quint32 requestId)
+{
+    Entry entry;
+    entry.timestamp = QDateTime::currentMSecsSinceEpoch();
+    entry.kind = kind;
+    entry.requestId = requestId;
+    entry.payload = payload;
+    append(QVector<Entry>{entry});
+}
+
+void LogModel::append(const QVector<Entry> &block)
+{
+    int next = 0;
+    const int room = qMin<int>(block.size(), maxEntries - entries.size());
+    if (room > 0)
+    {
+        const int first = entries.size();
+        beginInsertRows(QModelIndex(), first, first + room - 1);
+        for (; next < room; next++)
+            entries.append(block[next]);
+        endInsertRows();
+    }
+    if (next == block.size())
+        return;
+
+    // Voll: die ältesten Zeilen verschwinden oben, die neuen kommen unten dazu. Die Ansicht
+    // erfährt genau das (statt dataChanged über alle Zeilen) und verschiebt nur den Rest.
+    const int overflow = block.size() - next;
+    const int drop = qMin(overflow, maxEntries); // Ältere Teile eines übergroßen Blocks erscheinen nie
+    const int oldHead = head;
+    beginRemoveRows(QModelIndex(), 0, drop - 1);
+    head = (head + drop) % maxEntries;
+    hidden = drop;
+    endRemoveRows();
+
+    beginInsertRows(QModelIndex(), maxEntries - drop, maxEntries - 1);
+    const int firstNew = block.size() - drop;
+    for (int i = 0; i < drop; i++)
+        entries[(oldHead + i) % maxEntries] = block[firstNew + i];
+    hidden = 0;
+    endInsertRows();
+    dropped += overflow;
+}
+
+void LogModel::clear()
+{
+    beginResetModel();
+    entries.clear();
+    head = 0;
+    hidden = 0;
+    endResetModel();
+}
+
+int LogModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : entries.size() - hidden;
+}
+
+QVariant LogModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= rowCount())
+        return QVariant();
+
+    switch (role)
+    {
+    case Qt::DisplayRole:
+        return text(index.row());
+    case Qt::ForegroundRole:
+    {
+        const Kind kind = at(index.row()).kind;
+        if (kind == Warning || kind == Error)
+            return QBrush(Qt::red);
+        return QVariant();
+    }
+    default:
+        return QVariant();
+    }
+}
+
+QString LogModel::text(int row) const
+{
+    return format(at(row));
+}
+
+// Text wird erst beim Zeichnen oder Export erzeugt, gespeichert sind nur die Rohdaten
+QString LogModel::format(const Entry &entry)
+{
+    QString line = QDateTime::fromMSecsSinceEpoch(entry.timestamp).toString("hh:mm:ss.zzz") + "  ";
+    if (entry.kind != Plain)
+        line += kindLabel(entry.kind) + ": ";
+    if (entry.requestId != 0)
+        line += QString("#%1 ").arg(entry.requestId);
+    return line + entry.payload;
+}
+
+QString LogModel::kindLabel(Kind kind)
+{
+    switch (kind)
+    {
+    case Info:
+        return "Info";
+    case Sent:
+        return "Sent";
+    case Response:
+        return "Response";
+    case Warning:
+        return "Warning";
+    case Error:
+        return "Error";
+    default:
+        return QString();
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef LOGMODEL_H
+#define LOGMODEL_H
+
+#include <QAbstractListModel>
+#include <QString>
+#include <QVector>
+
+// Log mit fester Kapazität: die Einträge liegen in einem Ringpuffer, ist er voll,
+// wird der älteste überschrieben. Speicher und Kosten pro Eintrag bleiben damit auch in
+// langen Sitzungen konstant. Die Ansicht (QListView) zeichnet nur die sichtbaren Zeilen.
+class LogModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    enum Kind : quint8
+    {
+        Plain,    // Ohne Kennzeichnung, z.B. "COM ports refreshed."
+        Info,
+        Sent,
+        Response,
+        Warning,
+        Error
+    };
+
+    struct Entry
+    {
+        qint64 timestamp = 0;  // ms seit Epoch
+        Kind kind = Plain;
+        quint32 requestId = 0; // 0: keine Anfrage
+        QString payload;
+    };
+
+    // Unveränderliche Sicht auf alle Einträge, z.B. für den Export in einem anderen Thread.
+    // Die Kopie teilt die Daten mit dem Modell (implicit sharing); erst das nächste append()
+    // kopiert die Eintragsliste einmal, die Texte selbst bleiben geteilt.
+    struct Snapshot
+    {
+        QVector<Entry> entries;
+        int head = 0;
+
+        int size() const { return entries.size(); }
+        const Entry &at(int row) const { return entries.at((head + row) % entries.size()); }
+    };
+
+    explicit LogModel(int capacity = DefaultCapacity, QObject *parent = nullptr);
+
+    void append(Kind kind, const QString &payload, quint32 requestId = 0);
+    void append(const QVector<Entry> &block); // Ein Block, eine Benachrichtigung der Ansicht
+    void clear();
+    int capacity() const { return maxEntries; }
+    quint64 droppedCount() const { return dropped; } // Überschriebene Einträge seit dem Start
+    QString text(int row) const;                      // Zeile wie in der Ansicht
+    Snapshot snapshot() const { return Snapshot{entries, head}; }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    static QString kindLabel(Kind kind);
+    static QString format(const Entry &entry); // Textzeile eines Eintrags
+
+    static constexpr int DefaultCapacity = 100000;
+
+private:
+    const Entry &at(int row) const { return entries[(head + row) % maxEntries]; }
+
+    QVector<Entry> entries; // Wächst bis maxEntries, danach Ringpuffer
+    int head = 0;           // Index des ältesten Eintrags
+    int hidden = 0;         // Nur in append(): entfernte, noch nicht neu belegte Plätze am Ende
+    int maxEntries;
+    quint64 dropped = 0;
+};
+
+#endif // LOGMODEL_H
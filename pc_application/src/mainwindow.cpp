@@ -1,103 +1,85 @@
 #include "mainwindow.h"
 #include <QKeyEvent> //Damit man die Berechnung auch mit der Enter-Taste senden kann!
-#include <QDateTime>
-#include <QDir>
 #include <QFile>
 #include <QTextStream>
 #include <QMessageBox>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
-
-// ConnectionChecker Implementation
-ConnectionChecker::ConnectionChecker(QSerialPort *serial, QObject *parent)
-    : QThread(parent), serial(serial), running(true), highPriority(false), processing(false) {}
-
-// Stoppt den Prüfvorgang
-void ConnectionChecker::stopChecking()
-{
-    running = false;
-}
-
-// Legt die Priorität für Verbindungsprüfungen fest
-void ConnectionChecker::setPriority(bool highPriority)
-{
-    this->highPriority = highPriority;
-}
-
-// Setzt das Verarbeitungsflag
-void ConnectionChecker::setProcessingFlag(bool processing)
-{
-    this->processing = processing;
-}
-
-// Die Hauptfunktion des Threads zur Überwachung der Verbindung
-void ConnectionChecker::run()
-{
-    while (running)
-    {
-        QThread::msleep(highPriority ? 50 : 100);
-        bool isOpen = false;
-
-        try
-        {
-            MainWindow *mainWindow = static_cast<MainWindow *>(parent());
-            if (!mainWindow->isProcessing())
-            {
-                isOpen = serial->isOpen() && serial->isWritable();
-                if (isOpen)
-                {
-                    QByteArray test = serial->read(1);
-                    if (test.isEmpty() && serial->error() != QSerialPort::NoError)
-                    {
-                        isOpen = false; // Verbindung als getrennt markieren
-                    }
-                }
-            }
-            else
-            {
-                isOpen = true; // Während der Verarbeitung Verbindung als offen annehmen
-            }
-        }
-        catch (...)
-        {
-            isOpen = false; // Fehlerhafte Verbindung als getrennt markieren
-        }
-
-        emit connectionStatusChanged(isOpen); // Sende den Status
-    }
-}
-
+#include "expression.h"
+#include "errorlog.h"
+#include "logexporter.h"
+#include <QHeaderView>
+#include <QScrollBar>
+#include <QDateTime>
 
 // MainWindow Implementation
 MainWindow::MainWindow(QWidget *parent)
-    : QMainWindow(parent), serial(new QSerialPort(this)), processing(false), isConnected(false)
+    : QMainWindow(parent), link(new SerialLink(this)), isConnected(false)
 {
     // GUI setup
     QWidget *centralWidget = new QWidget(this);
     QVBoxLayout *mainLayout = new QVBoxLayout(centralWidget);
     QHBoxLayout *portLayout = new QHBoxLayout();
     QHBoxLayout *buttonLayout = new QHBoxLayout();
+    QHBoxLayout *cacheLayout = new QHBoxLayout();
+    QHBoxLayout *statsButtonLayout = new QHBoxLayout();
 
     inputLabel = new QLabel("Select COM Port and Connect:", this);
     portSelector = new QComboBox(this);
     refreshPortsButton = new QPushButton("Refresh Ports", this);
-    portLayout->addWidget(portSelector);
+    autoConnectCheckBox = new QCheckBox("Auto-connect Arduino", this);
+    autoConnectCheckBox->setToolTip("Connect as soon as a board with a known Arduino USB ID is plugged in.");
+    portLayout->addWidget(portSelector, 1);
     portLayout->addWidget(refreshPortsButton);
-    logOutput = new QTextEdit(this);
-    logOutput->setReadOnly(true);
+    portLayout->addWidget(autoConnectCheckBox);
+    logModel = new LogModel(LogModel::DefaultCapacity, this);
+    logView = new QListView(this);
+    logView->setModel(logModel);
+    logView->setUniformItemSizes(true); // Zeilenhöhe nicht pro Eintrag berechnen
+    logView->setVerticalScrollMode(QAbstractItemView::ScrollPerItem); // Bildlaufwert in Zeilen, siehe flushFrame()
+    logView->setSelectionMode(QAbstractItemView::ExtendedSelection);
     inputField = new QLineEdit(this);
-    inputField->setPlaceholderText("Enter operation: a+b | a-b | a*b | a/b");
-    inputField->setEnabled(false);
+    inputField->setPlaceholderText("Enter expression: a+b | a-b | a*b | a/b | (a+b)*-c");
 
     connectButton = new QPushButton("Connect", this);
     sendButton = new QPushButton("Send", this);
-    sendButton->setEnabled(false);
     saveLogButton = new QPushButton("Save Log", this);
     exitButton = new QPushButton("Exit", this);
     buttonLayout->addWidget(connectButton);
     buttonLayout->addWidget(sendButton);
     buttonLayout->addWidget(saveLogButton);
     buttonLayout->addWidget(exitButton);
+    exportProgress = new QProgressBar(this);
+    exportProgress->setVisible(false);
+    cacheSizeInput = new QSpinBox(this);
+    cacheSizeInput->setRange(0, 100000);
+    cacheSizeInput->setPrefix("Cache size: ");
+    cacheSizeInput->setToolTip("Number of results kept on the PC, 0 disables the cache.");
+    offloadCheckBox = new QCheckBox("Compute on PC when device is busy or offline", this);
+    offloadCheckBox->setChecked(true);
+    binaryFloatsCheckBox = new QCheckBox("Binary floats", this);
+    binaryFloatsCheckBox->setToolTip("Send operands and results as 4-byte floats; the PC does all decimal conversion.");
+    engineStatsLabel = new QLabel(this);
+    cacheLayout->addWidget(cacheSizeInput);
+    cacheLayout->addWidget(offloadCheckBox);
+    cacheLayout->addWidget(binaryFloatsCheckBox);
+    cacheLayout->addWidget(engineStatsLabel, 1);
+    statsTable = new QTableWidget(LatencyStats::StageCount, LatencyStats::columns().size(), this);
+    statsTable->setHorizontalHeaderLabels(LatencyStats::columns());
+    statsTable->verticalHeader()->setVisible(false);
+    statsTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    statsTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    statsTable->setMaximumHeight(200);
+    exportStatsButton = new QPushButton("Export Stats", this);
+    resetStatsButton = new QPushButton("Reset Stats", this);
+    statsButtonLayout->addStretch(1);
+    statsButtonLayout->addWidget(resetStatsButton);
+    statsButtonLayout->addWidget(exportStatsButton);
+    statsRefreshTimer = new QTimer(this);
+    statsRefreshTimer->start(500);
+    uiFrameTimer = new QTimer(this);
+    uiFrameTimer->setSingleShot(true);
+    uiFrameTimer->setInterval(1000 / FrameRate);
     statusLED = new QLabel(this);
     statusLED->setFixedSize(20, 20);
     statusLED->setStyleSheet("background-color: red; border-radius: 10px;");
@@ -105,8 +87,12 @@ MainWindow::MainWindow(QWidget *parent)
     mainLayout->addWidget(statusLED);
     mainLayout->addWidget(inputLabel);
     mainLayout->addLayout(portLayout);
-    mainLayout->addWidget(logOutput);
+    mainLayout->addWidget(logView);
+    mainLayout->addWidget(exportProgress);
+    mainLayout->addWidget(statsTable);
+    mainLayout->addLayout(statsButtonLayout);
     mainLayout->addWidget(inputField);
+    mainLayout->addLayout(cacheLayout);
     mainLayout->addLayout(buttonLayout);
 
     setCentralWidget(centralWidget);
@@ -116,22 +102,73 @@ MainWindow::MainWindow(QWidget *parent)
     connect(saveLogButton, &QPushButton::clicked, this, &MainWindow::saveLog);
     connect(exitButton, &QPushButton::clicked, this, &MainWindow::exitApplication);
     connect(refreshPortsButton, &QPushButton::clicked, this, &MainWindow::refreshPorts);
-
-    connectionChecker = new ConnectionChecker(serial, this);
-    connect(connectionChecker, &ConnectionChecker::connectionStatusChanged, this, &MainWindow::updateConnectionStatus);
+    connect(exportStatsButton, &QPushButton::clicked, this, &MainWindow::exportStats);
+    connect(resetStatsButton, &QPushButton::clicked, this, &MainWindow::resetStats);
+    connect(statsRefreshTimer, &QTimer::timeout, this, &MainWindow::refreshStatsTable);
+    connect(uiFrameTimer, &QTimer::timeout, this, &MainWindow::flushFrame);
+
+    connect(link, &SerialLink::responseReceived, this, &MainWindow::handleResponse);
+    connect(link, &SerialLink::requestFailed, this, &MainWindow::handleRequestFailed);
+    connect(link, &SerialLink::requestTimed, this, &MainWindow::handleRequestTimed);
+    connect(link, &SerialLink::idle, this, [this]() { processing = false; });
+    cacheSizeInput->setValue(link->cacheSize());
+    connect(cacheSizeInput, &QSpinBox::valueChanged, link, &SerialLink::setCacheSize);
+    connect(binaryFloatsCheckBox, &QCheckBox::toggled, link, &SerialLink::setBinaryFloats);
+    link->setOffloadPolicy(RequestEngine::Adaptive);
+    connect(offloadCheckBox, &QCheckBox::toggled, this, [this](bool checked) {
+        link->setOffloadPolicy(checked ? RequestEngine::Adaptive : RequestEngine::DeviceOnly);
+        updateInputEnabled();
+    });
+    updateEngineStats();
+    updateInputEnabled();
+    statsDirty = true;
+    refreshStatsTable();
+
+    connect(link, &SerialLink::linkNegotiated, this, &MainWindow::handleLinkNegotiated);
+    connect(link, &SerialLink::connectionStatusChanged, this, &MainWindow::updateConnectionStatus);
+    connect(link, &SerialLink::opened, this, [this](const QString &portName) {
+        appendLog(LogModel::Plain, "Connected to " + portName + ", negotiating link...");
+    });
+    connect(link, &SerialLink::openFailed, this, [this](const QString &portName, const QString &error) {
+        Q_UNUSED(portName);
+        QMessageBox::warning(this, "Connection Error", "Could not open the selected COM port.\n" + error);
+    });
     // **Enter-Taste soll senden**
     connect(inputField, &QLineEdit::returnPressed, this, &MainWindow::handleEnterPressed);
 
-    refreshPorts();
-    connectionChecker->start();
+    // Portsuche im Hintergrund, das Fenster erscheint ohne auf udev zu warten
+    portWatcher = new PortWatcher;
+    portThread = new QThread(this);
+    portWatcher->moveToThread(portThread);
+    connect(portThread, &QThread::started, portWatcher, &PortWatcher::run);
+    connect(portThread, &QThread::finished, portWatcher, &QObject::deleteLater);
+    connect(portWatcher, &PortWatcher::portsChanged, this, &MainWindow::handlePortsChanged);
+    connect(portWatcher, &PortWatcher::refreshed, this, [this](int count) {
+        appendLog(LogModel::Plain, count == 0 ? "No COM ports available." : "COM ports refreshed.");
+    });
+    connect(autoConnectCheckBox, &QCheckBox::toggled, this, [this](bool checked) {
+        if (!checked)
+            return;
+        QStringList ports;
+        for (int i = 0; i < portSelector->count(); i++)
+            ports.append(portSelector->itemText(i));
+        autoConnect(ports);
+    });
+    portThread->start();
 }
 
 
 MainWindow::~MainWindow()
 {
-    connectionChecker->stopChecking();
-    connectionChecker->wait();
-    delete connectionChecker;
+    portThread->quit();
+    portThread->wait();
+    if (exportThread != nullptr)
+    {
+        logExporter->cancel();
+        exportThread->quit();
+        exportThread->wait();
+        delete logExporter;
+    }
 }
 
 // Aktualisiert den Verbindungsstatus
@@ -144,17 +181,15 @@ void MainWindow::updateConnectionStatus(bool isConnected)
 
         if (!isConnected)
         {
-            logOutput->append("<b>Warning:</b> Connection lost.");
+            appendLog(LogModel::Warning, "Connection lost.");
             connectButton->setText("Connect");
-            inputField->setEnabled(false);
-            sendButton->setEnabled(false);
+            updateInputEnabled();
         }
         else
         {
-            logOutput->append("<b>Info:</b> Connected.");
+            appendLog(LogModel::Info, "Connected.");
             connectButton->setText("Disconnect");
-            inputField->setEnabled(true);
-            sendButton->setEnabled(true);
+            updateInputEnabled();
         }
     }
 }
@@ -168,60 +203,65 @@ bool MainWindow::isProcessing() const
 // Die Eingabe an den µC Senden
 void MainWindow::sendCalculation()
 {
+    const qint64 validatedAt = link->elapsedNs(); // Beginn der Stufe "validate"
     QString calculation = inputField->text();
     if (calculation.isEmpty())
     {
-        logOutput->append("<b>Error:</b> Input field is empty!");
+        appendLog(LogModel::Error, "Input field is empty!");
         return;
     }
-    // Eingabe validieren
-    if (!check_input(calculation))
+    // Eingabe validieren, einfache Ausdrücke sind danach schon zerlegt
+    Expression::Parsed parsed;
+    if (!check_input(calculation, parsed))
     {
-        logOutput->append("<b>Error:</b> Invalid input format! Use a+b | a-b | a*b | a/b.");
+        appendLog(LogModel::Error, Expression::statusText(Expression::InvalidFormat));
         return;
     }
 
-    calculation.replace(',', '.');
-    calculation += '\n'; // **Newline für Arduino!**
-
+    calculation = Expression::normalize(calculation);
 
-    if (serial->isOpen() && serial->isWritable())
+    if (link->isOpen() || offloadCheckBox->isChecked())
     {
-        serial->write(calculation.toUtf8());
-        serial->flush();
-        logOutput->append("<b>Sent:</b> " + calculation);
-
-        QByteArray response;
-        while (serial->waitForReadyRead(1000))
-        {
-            response += serial->readAll();
-            if (response.endsWith('\n') || response.endsWith('\r') || response.endsWith("\r\n"))
-                break;
-        }
-
-        if (response.isEmpty())
+        // Nicht blockieren: die Antwort kommt über handleResponse()
+        const quint32 id = link->submit(calculation, parsed, validatedAt); // Bekannte Ausdrücke beantwortet der Cache, ohne Gerät rechnet der PC
+        if (id == 0)
         {
-            logOutput->append("<b><font color='red'>Warning:</font></b> No response received!");
-        }
-        else
-        {
-            logOutput->append("<b>Response:</b> " + QString::fromUtf8(response.trimmed()));
+            appendLog(LogModel::Error, "Too many pending requests!");
+            return;
         }
+        processing = true;
+        appendLog(LogModel::Sent, calculation, id);
+        engineStatsDirty = true;
     }
     else
     {
-        logOutput->append("<b>Error:</b> Serial port not available!");
+        appendLog(LogModel::Error, "Serial port not available!");
         updateLED(false);
         connectButton->setText("Connect");
     }
 }
 
+// Antwort des µC zur passenden Anfrage anzeigen
+void MainWindow::handleResponse(quint32 id, const QString &expression, const QString &response)
+{
+    Q_UNUSED(expression);
+    appendLog(LogModel::Response, response, id);
+    engineStatsDirty = true;
+}
+
+// Anfrage ohne Antwort (Timeout) oder verworfen (Verbindung getrennt)
+void MainWindow::handleRequestFailed(quint32 id, const QString &expression, const QString &reason)
+{
+    appendLog(LogModel::Warning, expression + ": " + reason, id);
+    writeErrorLog(QString("Request #%1 failed (%2): %3").arg(id).arg(expression, reason));
+}
+
 
 //Damit man auch mit Enter-Taste die Berechnung senden kann
 void MainWindow::handleEnterPressed() {
-    if (!isConnected)
+    if (!isConnected && !offloadCheckBox->isChecked())
     {
-        logOutput->append("<b>Error:</b> Please connect first!");
+        appendLog(LogModel::Error, "Please connect first!");
         return;
     }
     sendCalculation();
@@ -230,22 +270,60 @@ void MainWindow::handleEnterPressed() {
 // Refresh available ports
 void MainWindow::refreshPorts()
 {
-    portSelector->clear();
-    const auto ports = QSerialPortInfo::availablePorts();
-    for (const QSerialPortInfo &port : ports)
+    QMetaObject::invokeMethod(portWatcher, &PortWatcher::rescan, Qt::QueuedConnection); // Antwort über refreshed()
+}
+
+// Nur geänderte Einträge anfassen, die Auswahl des Benutzers bleibt erhalten
+void MainWindow::handlePortsChanged(const QList<PortWatcher::Port> &added, const QStringList &removed)
+{
+    for (const QString &name : removed)
     {
-        portSelector->addItem(port.portName());
+        const int index = portSelector->findText(name);
+        if (index >= 0)
+            portSelector->removeItem(index);
+        appendLog(LogModel::Plain, "Port " + name + " removed.");
+    }
+
+    QStringList boards;
+    for (const PortWatcher::Port &port : added)
+    {
+        int index = 0;
+        while (index < portSelector->count() && portSelector->itemText(index) < port.name)
+            index++;
+        portSelector->insertItem(index, port.name, port.isKnownBoard());
+        portSelector->setItemData(index, port.description, Qt::ToolTipRole);
+        appendLog(LogModel::Plain, port.description.isEmpty() ? "Port " + port.name + " added."
+                                                              : "Port " + port.name + " added (" + port.description + ").");
+        boards.append(port.name);
+    }
+    autoConnect(boards);
+}
+
+// Beim manuellen Trennen bleibt der Port in der Liste und wird nicht erneut verbunden;
+// erst ein neu eingestecktes Board oder das Einschalten der Option verbindet wieder
+void MainWindow::autoConnect(const QStringList &candidates)
+{
+    if (!autoConnectCheckBox->isChecked() || link->isOpen())
+        return;
+    for (const QString &name : candidates)
+    {
+        const int index = portSelector->findText(name);
+        if (index < 0 || !portSelector->itemData(index).toBool())
+            continue;
+        portSelector->setCurrentIndex(index);
+        appendLog(LogModel::Info, "Arduino found on " + name + ".");
+        toggleConnection();
+        return;
     }
-    logOutput->append(ports.isEmpty() ? "No COM ports available." : "COM ports refreshed.");
 }
 
 // Toggle Connection
 void MainWindow::toggleConnection()
 {
-    if (serial->isOpen()) // Verbindung trennen wenn verbunden
+    if (link->isOpen()) // Verbindung trennen wenn verbunden
     {
         manualDisconnection = true;
-        serial->close();
+        link->close();
         updateConnectionStatus(false); // Verbindung als getrennt melden
         return;
     }
@@ -257,81 +335,192 @@ void MainWindow::toggleConnection()
         return;
     }
 
-    serial->setPortName(selectedPort);
-    serial->setBaudRate(QSerialPort::Baud9600);
-    serial->setDataBits(QSerialPort::Data8);
-    serial->setParity(QSerialPort::NoParity);
-    serial->setStopBits(QSerialPort::OneStop);
-    serial->setFlowControl(QSerialPort::NoFlowControl);
+    manualDisconnection = false;
+    link->open(selectedPort); // Im I/O-Thread, Ergebnis über opened() oder openFailed()
+}
+
+// Handshake abgeschlossen: ab jetzt überwacht der LinkMonitor die Verbindung
+void MainWindow::handleLinkNegotiated(bool framed, qint32 baudRate, quint8 version)
+{
+    if (framed)
+        appendLog(LogModel::Info, QString("Protocol v%1, %2 baud.").arg(version).arg(baudRate));
+    else
+        appendLog(LogModel::Info, QString("Legacy firmware, text protocol at %1 baud.").arg(baudRate));
+}
 
-    if (serial->open(QIODevice::ReadWrite)) // Verbindung herstellen
+// Neuer Logeintrag; er erscheint mit dem nächsten Frame, der Zeitstempel gilt ab jetzt
+void MainWindow::appendLog(LogModel::Kind kind, const QString &text, quint32 requestId)
+{
+    pendingLog.append(LogModel::Entry{QDateTime::currentMSecsSinceEpoch(), kind, requestId, text});
+    scheduleFrame();
+}
+
+// Bei hoher Anfragerate fallen viele Antworten in einen Frame: Ansicht, Scrollbalken und
+// Zähler werden dann einmal pro Frame statt einmal pro Antwort aktualisiert
+void MainWindow::scheduleFrame()
+{
+    if (!uiFrameTimer->isActive())
+        uiFrameTimer->start();
+}
+
+// Die Ansicht folgt nur, wenn sie schon am Ende stand. Sonst bleiben die betrachteten
+// Zeilen stehen, auch wenn oben die ältesten aus dem vollen Log fallen.
+void MainWindow::flushFrame()
+{
+    if (!pendingLog.isEmpty())
     {
-        manualDisconnection = false;
-        logOutput->append("Connected to " + selectedPort + ".");
-        updateConnectionStatus(true);
+        QScrollBar *scrollBar = logView->verticalScrollBar();
+        const bool atBottom = scrollBar->value() == scrollBar->maximum();
+        const int position = scrollBar->value();
+        const quint64 droppedBefore = logModel->droppedCount();
+        logModel->append(pendingLog);
+        pendingLog.clear();
+        if (atBottom)
+            logView->scrollToBottom();
+        else
+            scrollBar->setValue(position - static_cast<int>(qMin<quint64>(logModel->droppedCount() - droppedBefore, position)));
     }
-    else
+    if (engineStatsDirty)
     {
-        QMessageBox::warning(this, "Connection Error", "Could not open the selected COM port.");
+        engineStatsDirty = false;
+        updateEngineStats();
     }
 }
 
+void MainWindow::updateEngineStats()
+{
+    engineStatsLabel->setText(QString("Cache: %1 hits, %2 misses | PC: %3 | RTT: %4 ms")
+                                  .arg(link->cacheHits())
+                                  .arg(link->cacheMisses())
+                                  .arg(link->hostEvaluations())
+                                  .arg(link->deviceRttUs() / 1000.0, 0, 'f', 1));
+}
+
+void MainWindow::updateInputEnabled()
+{
+    const bool enabled = isConnected || offloadCheckBox->isChecked();
+    inputField->setEnabled(enabled);
+    sendButton->setEnabled(enabled);
+}
+
+void MainWindow::handleRequestTimed(quint32 id, const StageTimes &times)
+{
+    Q_UNUSED(id);
+    latencyStats.record(times);
+    statsDirty = true; // Tabelle wird gebündelt vom Timer aktualisiert
+}
+
+void MainWindow::refreshStatsTable()
+{
+    if (!statsDirty)
+        return;
+    statsDirty = false;
+    for (int stage = 0; stage < LatencyStats::StageCount; stage++)
+    {
+        const QStringList row = latencyStats.row(static_cast<LatencyStats::Stage>(stage));
+        for (int column = 0; column < row.size(); column++)
+        {
+            QTableWidgetItem *item = statsTable->item(stage, column);
+            if (item == nullptr)
+            {
+                item = new QTableWidgetItem();
+                statsTable->setItem(stage, column, item);
+            }
+            item->setText(row[column]);
+        }
+    }
+}
+
+void MainWindow::exportStats()
+{
+    QString fileName = QFileDialog::getSaveFileName(this, "Export Stats", "", "CSV Files (*.csv);;All Files (*)");
+    if (fileName.isEmpty())
+        return;
+
+    QFile file(fileName);
+    if (file.open(QIODevice::WriteOnly | QIODevice::Text) && latencyStats.exportCsv(&file))
+        appendLog(LogModel::Plain, "Stats exported successfully.");
+    else
+        appendLog(LogModel::Error, "Could not export the stats.");
+}
+
+void MainWindow::resetStats()
+{
+    latencyStats.clear();
+    statsDirty = true;
+    refreshStatsTable();
+}
+
 // Update LED
 void MainWindow::updateLED(bool isConnected)
 {
+    if (isConnected == ledConnected) // setStyleSheet erzwingt Polish und Neuzeichnen, auch ohne Änderung
+        return;
+    ledConnected = isConnected;
     statusLED->setStyleSheet(isConnected ? "background-color: green; border-radius: 10px;" : "background-color: red; border-radius: 10px;");
 }
 
 // Speichert die Kommunikationhistorie in eine Text-Datei
 void MainWindow::saveLog()
 {
-    QString fileName = QFileDialog::getSaveFileName(this, "Save Log", "", "Text Files (*.txt);;All Files (*)");
+    if (exportThread != nullptr) // Button dient während des Exports als Abbruch
+    {
+        logExporter->cancel();
+        return;
+    }
+
+    QString fileName = QFileDialog::getSaveFileName(this, "Save Log", "",
+                                                    "Text Files (*.txt);;CSV Files (*.csv);;Binary Log (*.clog);;All Files (*)");
     if (fileName.isEmpty())
         return;
 
-    QFile file(fileName);
-    if (file.open(QIODevice::WriteOnly | QIODevice::Text))
-    {
-        QTextStream out(&file);
-        out << logOutput->toPlainText();
-        file.close();
-        logOutput->append("Log saved successfully.");
-    }
+    flushFrame(); // Noch nicht angezeigte Einträge gehören mit in die Datei
+    // Momentaufnahme statt des Modells: neue Einträge während des Exports stören nicht
+    logExporter = new LogExporter(logModel->snapshot(), fileName, LogExporter::formatForFile(fileName));
+    exportThread = new QThread(this);
+    logExporter->moveToThread(exportThread);
+    connect(exportThread, &QThread::started, logExporter, &LogExporter::run);
+    connect(logExporter, &LogExporter::progress, this, [this](int done, int total) {
+        exportProgress->setMaximum(qMax(1, total));
+        exportProgress->setValue(done);
+    });
+    connect(logExporter, &LogExporter::finished, this, &MainWindow::handleExportFinished);
+
+    exportProgress->setValue(0);
+    exportProgress->setVisible(true);
+    saveLogButton->setText("Cancel Save");
+    exportThread->start();
+}
+
+void MainWindow::handleExportFinished(bool ok, const QString &error)
+{
+    // run() ist mit dem Signal fertig, der Thread endet sofort
+    exportThread->quit();
+    exportThread->wait();
+    delete logExporter;
+    delete exportThread;
+    logExporter = nullptr;
+    exportThread = nullptr;
+
+    exportProgress->setVisible(false);
+    saveLogButton->setText("Save Log");
+    if (ok)
+        appendLog(LogModel::Plain, "Log saved successfully.");
     else
-    {
-        logOutput->append("Error: Could not save the log.");
-    }
+        appendLog(LogModel::Error, "Could not save the log: " + error);
 }
 
 // Überprüft die Eingabe des Benutzers
-bool MainWindow::check_input(const QString &input)
+bool MainWindow::check_input(const QString &input, Expression::Parsed &parsed)
 {
     try
     {
-        QString sanitizedInput = input;
-        sanitizedInput.replace(',', '.'); // Ersetze Kommas durch Punkte
-
-        // Überprüfe das Eingabeformat: <Zahl><Operator><Zahl>
-        QRegularExpression regex("^([-+]?[0-9]*\\.?[0-9]+)\\s*([+\\-*/])\\s*([-+]?[0-9]*\\.?[0-9]+)$");
-        QRegularExpressionMatch match = regex.match(sanitizedInput);
-
-        if (match.hasMatch())
+        parsed = Expression::parse(input);
+        if (parsed.status != Expression::Valid && parsed.status != Expression::InvalidFormat)
         {
-            // Überprüfe Division durch Null
-            double num2 = match.captured(3).toDouble();
-            QString op = match.captured(2);
-
-            if (op == "/" && num2 == 0)
-            {
-                logOutput->append("Error: Division by zero is not allowed!");
-                return false;
-            }
-            return true;
-        }
-        else
-        {
-            return false; // Eingabe ungültig
+            appendLog(LogModel::Error, Expression::statusText(parsed.status));
         }
+        return parsed.status == Expression::Valid;
     }
     catch (const std::exception &e)
     {
@@ -345,16 +534,10 @@ bool MainWindow::check_input(const QString &input)
     }
 }
 
-//Schreibt in die Log-Datei falls Fehler auftreten
+//Schreibt in die Log-Datei falls Fehler auftreten (asynchron, siehe ErrorLog)
 void MainWindow::writeErrorLog(const QString &message)
 {
-    QFile logFile(QDir::currentPath() + "/error_log.txt");
-    if (logFile.open(QIODevice::Append | QIODevice::Text))
-    {
-        QTextStream out(&logFile);
-        out << QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss") << " - " << message << "\n";
-        logFile.close();
-    }
+    ErrorLog::instance().write(message);
 }
 
 // Exit Application
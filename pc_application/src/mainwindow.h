@@ -2,49 +2,33 @@
 #define MAINWINDOW_H
 
 #include <QApplication>
-#include <QThread>
 #include <QMainWindow>
 #include <QPushButton>
 #include <QLineEdit>
-#include <QTextEdit>
+#include <QListView>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QLabel>
-#include <QSerialPort>
-#include <QSerialPortInfo>
 #include <QComboBox>
+#include <QSpinBox>
+#include <QCheckBox>
+#include <QTableWidget>
 #include <QMessageBox>
 #include <QFile>
 #include <QTextStream>
 #include <QFileDialog>
 #include <QTimer>
-#include <QRegularExpression>
+#include <QThread>
+#include <QProgressBar>
+#include <atomic>
+#include "seriallink.h"
+#include "expression.h"
+#include "latencystats.h"
+#include "logmodel.h"
+#include "logexporter.h"
+#include "portwatcher.h"
 // #include <QKeyEvent>
 
-// Klasse zum Überprüfen der Verbindung
-class ConnectionChecker : public QThread
-{
-    Q_OBJECT
-
-public:
-    explicit ConnectionChecker(QSerialPort *serial, QObject *parent = nullptr); // Konstruktor ohne Mutex
-    void stopChecking();                                                        // Beendet den Thread
-    void setPriority(bool highPriority);                                        // Setzt die Priorität für die Überprüfung
-    void setProcessingFlag(bool processing);                                    // Setzt den "processing"-Status
-
-protected:
-    void run() override; // Hauptfunktion des Threads
-
-signals:
-    void connectionStatusChanged(bool isConnected); // Signal, wenn sich der Verbindungsstatus ändert
-
-private:
-    QSerialPort *serial; // Zeiger auf das serielle Gerät
-    bool running;        // Kontrolliert den Thread
-    bool highPriority;   // Bestimmt die Häufigkeit der Überprüfung
-    bool processing;     // Gibt an, ob eine Berechnung aktiv ist
-};
-
 // Hauptklasse für die Anwendung
 class MainWindow : public QMainWindow
 {
@@ -60,24 +44,53 @@ private slots:
     void saveLog();                                // Funktion zum Speichern des Logs
     void toggleConnection();                       // Verbindung herstellen oder trennen
     void exitApplication();                        // Beendet die Anwendung
-    bool check_input(const QString &input);        // Überprüft die Eingabe auf Gültigkeit
+    bool check_input(const QString &input, Expression::Parsed &parsed); // Überprüft die Eingabe auf Gültigkeit
     void refreshPorts();                           // Aktualisiert die Liste der verfügbaren Ports
+    void handlePortsChanged(const QList<PortWatcher::Port> &added, const QStringList &removed); // Auswahlfeld nachführen
     void updateConnectionStatus(bool isConnected); // Aktualisiert den Verbindungsstatus
     void handleEnterPressed();                     // Enter zum "Senden"
+    void handleResponse(quint32 id, const QString &expression, const QString &response); // Antwort des µC anzeigen
+    void handleRequestFailed(quint32 id, const QString &expression, const QString &reason); // Fehlgeschlagene Anfrage anzeigen
+    void handleLinkNegotiated(bool framed, qint32 baudRate, quint8 version); // Handshake nach dem Verbinden abgeschlossen
+    void handleRequestTimed(quint32 id, const StageTimes &times); // Zeitpunkte einer Anfrage in die Histogramme
+    void refreshStatsTable();                      // Statistik-Tabelle neu füllen, falls sich etwas geändert hat
+    void exportStats();                            // Latenzstatistik als CSV speichern
+    void resetStats();                             // Histogramme leeren
+    void handleExportFinished(bool ok, const QString &error); // Export-Thread beenden, Ergebnis melden
 private:
-    QSerialPort *serial;                  // Serielles Gerät
-    bool processing = false;              // Status, ob aktuell eine Aktion ausgeführt wird
-    ConnectionChecker *connectionChecker; // Zeiger auf den Verbindungsprüfer
+    SerialLink *link;                     // Port, Engine, Handshake und Überwachung im I/O-Thread
+    std::atomic<bool> processing{false};  // Status, ob aktuell eine Aktion ausgeführt wird
     QPushButton *connectButton;           // Verbindungsbutton
     QPushButton *sendButton;              // Senden-Button
     QPushButton *saveLogButton;           // Log speichern
     QPushButton *exitButton;              // Exit-Button
     QPushButton *refreshPortsButton;      // Ports aktualisieren
+    QCheckBox *autoConnectCheckBox;       // Mit einem eingesteckten Arduino automatisch verbinden
+    PortWatcher *portWatcher;             // Sucht Ports im Hintergrund, lebt in portThread
+    QThread *portThread;                  // Läuft, solange das Fenster existiert
     QLineEdit *inputField;                // Eingabefeld für Berechnungen
-    QTextEdit *logOutput;                 // Anzeige des Logs
+    LogModel *logModel;                   // Log als Ringpuffer mit fester Kapazität
+    QListView *logView;                   // Anzeige des Logs, zeichnet nur sichtbare Zeilen
+    QProgressBar *exportProgress;         // Fortschritt von "Save Log", nur während des Exports sichtbar
+    QThread *exportThread = nullptr;      // Läuft nur während eines Exports
+    LogExporter *logExporter = nullptr;   // Lebt in exportThread
     QLabel *inputLabel;                   // Label für die Eingabe
     QLabel *statusLED;                    // LED-Statusanzeige
     QComboBox *portSelector;              // Auswahlfeld für die Ports
+    QSpinBox *cacheSizeInput;             // Größe des Ergebnis-Caches
+    QCheckBox *offloadCheckBox;           // Auf dem PC rechnen, wenn das Gerät ausgelastet oder getrennt ist
+    QCheckBox *binaryFloatsCheckBox;      // Zahlen als float statt als Text übertragen
+    QLabel *engineStatsLabel;             // Cache, Rechnungen auf dem PC, Antwortzeit
+    QTableWidget *statsTable;             // Latenz je Stufe (µs)
+    QPushButton *exportStatsButton;       // Statistik als CSV speichern
+    QPushButton *resetStatsButton;        // Statistik zurücksetzen
+    QTimer *statsRefreshTimer;            // Aktualisiert die Tabelle höchstens zweimal pro Sekunde
+    LatencyStats latencyStats;            // Histogramme je Stufe
+    bool statsDirty = false;              // Neue Messwerte seit der letzten Aktualisierung
+    QTimer *uiFrameTimer;                 // Sammelt Änderungen und zeichnet höchstens FrameRate-mal pro Sekunde
+    QVector<LogModel::Entry> pendingLog;  // Logeinträge seit dem letzten Frame
+    bool engineStatsDirty = false;        // Cache-Zähler usw. haben sich seit dem letzten Frame geändert
+    bool ledConnected = false;            // Aktuelle Farbe der LED, Stylesheet nur bei Wechsel setzen
     QTimer *connectionTimer;              // Timer für die regelmäßige Überprüfung der Verbindung
 
     // Variablen zur Verbindungsverwaltung
@@ -87,6 +100,14 @@ private:
     bool connectionLostDialogShown = false; // Verhindert mehrfaches Öffnen des Verbindungsverlustdialogs
 
     void updateLED(bool isConnected); // Aktualisiert die LED-Anzeige je nach Verbindungsstatus
+    void appendLog(LogModel::Kind kind, const QString &text, quint32 requestId = 0); // Eintrag ins Log
+    void updateEngineStats();         // Cache-Treffer, Rechnungen auf dem PC und Antwortzeit anzeigen
+    void scheduleFrame();             // Nächsten Frame einplanen, falls noch keiner ansteht
+    void flushFrame();                // Gesammelte Logeinträge und Zähler auf einmal übernehmen
+    void updateInputEnabled();        // Eingabe nur, wenn verbunden oder auf dem PC gerechnet werden darf
+    void autoConnect(const QStringList &candidates); // Mit dem ersten bekannten Board verbinden, falls gewünscht
+
+    static constexpr int FrameRate = 30; // Obergrenze für Aktualisierungen von Log und Zählern pro Sekunde
 };
 
 #endif // MAINWINDOW_H
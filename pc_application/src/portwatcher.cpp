@@ -0,0 +1,103 @@
+#include "portwatcher.h"
+#include <QFileSystemWatcher>
+#include <QSerialPortInfo>
+#include <QTimer>
+#include <algorithm>
+
+namespace
+{
+    struct KnownBoard
+    {
+        quint16 vendorId;
+        quint16 productId; // 0: alle Produkte des Herstellers
+    };
+
+    constexpr KnownBoard KnownBoards[] = {
+        {0x2341, 0},      // Arduino SA
+        {0x2A03, 0},      // Arduino.org
+        {0x1A86, 0x7523}, // CH340 auf Nachbauten
+    };
+}
+
+bool PortWatcher::Port::isKnownBoard() const
+{
+    if (!hasIds)
+        return false;
+    return std::any_of(std::begin(KnownBoards), std::end(KnownBoards), [this](const KnownBoard &board) {
+        return board.vendorId == vendorId && (board.productId == 0 || board.productId == productId);
+    });
+}
+
+PortWatcher::PortWatcher(QObject *parent)
+    : QObject(parent)
+{
+    qRegisterMetaType<QList<PortWatcher::Port>>();
+}
+
+// Timer und Watcher erst hier anlegen, damit sie im Port-Thread leben
+void PortWatcher::run()
+{
+    debounceTimer = new QTimer(this);
+    debounceTimer->setSingleShot(true);
+    debounceTimer->setInterval(DebounceMs);
+    connect(debounceTimer, &QTimer::timeout, this, &PortWatcher::scan);
+
+#ifdef Q_OS_LINUX
+    watcher = new QFileSystemWatcher(this);
+    if (watcher->addPath("/dev"))
+        connect(watcher, &QFileSystemWatcher::directoryChanged, debounceTimer, qOverload<>(&QTimer::start));
+#endif
+    if (watcher == nullptr || watcher->directories().isEmpty())
+    {
+        pollTimer = new QTimer(this);
+        connect(pollTimer, &QTimer::timeout, this, &PortWatcher::scan);
+        pollTimer->start(PollIntervalMs);
+    }
+    rescan();
+}
+
+void PortWatcher::rescan()
+{
+    scan();
+    emit refreshed(cache.size());
+}
+
+void PortWatcher::scan()
+{
+    QHash<QString, Port> current;
+    for (const QSerialPortInfo &info : QSerialPortInfo::availablePorts())
+    {
+        Port port;
+        port.name = info.portName();
+        port.description = info.description();
+        port.hasIds = info.hasVendorIdentifier() && info.hasProductIdentifier();
+        if (port.hasIds)
+        {
+            port.vendorId = info.vendorIdentifier();
+            port.productId = info.productIdentifier();
+        }
+        current.insert(port.name, port);
+    }
+
+    // Gleicher Name mit anderen IDs: anderes Gerät am selben Anschluss
+    QList<Port> added;
+    QStringList removed;
+    for (auto it = cache.cbegin(); it != cache.cend(); ++it)
+    {
+        const auto now = current.constFind(it.key());
+        if (now == current.cend() || now->vendorId != it->vendorId || now->productId != it->productId)
+            removed.append(it.key());
+    }
+    for (auto it = current.cbegin(); it != current.cend(); ++it)
+    {
+        const auto before = cache.constFind(it.key());
+        if (before == cache.cend() || before->vendorId != it->vendorId || before->productId != it->productId)
+            added.append(*it);
+    }
+    cache = current;
+
+    if (added.isEmpty() && removed.isEmpty())
+        return;
+    std::sort(added.begin(), added.end(), [](const Port &a, const Port &b) { return a.name < b.name; });
+    emit portsChanged(added, removed);
+}
@@ -0,0 +1,54 @@
+#ifndef PORTWATCHER_H
+#define PORTWATCHER_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QStringList>
+
+class QFileSystemWatcher;
+class QTimer;
+
+// Sucht serielle Ports in einem eigenen Thread: QSerialPortInfo::availablePorts() läuft
+// unter Linux durch sysfs und udev und kann spürbar dauern. Unter Linux löst jede
+// Änderung in /dev einen Scan aus, auf anderen Systemen wird regelmäßig gesucht.
+// Gemeldet werden nur Unterschiede zur zwischengespeicherten Liste des letzten Scans.
+class PortWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Port
+    {
+        QString name;
+        QString description;    // z.B. "Arduino Uno"
+        quint16 vendorId = 0;
+        quint16 productId = 0;
+        bool hasIds = false;    // USB-Gerät mit VID/PID
+
+        bool isKnownBoard() const; // VID/PID eines Arduino oder eines verbreiteten Nachbaus
+    };
+
+    explicit PortWatcher(QObject *parent = nullptr);
+
+public slots:
+    void run();    // Läuft im Port-Thread: Überwachung einrichten und erster Scan
+    void rescan(); // Sofort neu suchen, meldet danach refreshed()
+
+signals:
+    void portsChanged(const QList<PortWatcher::Port> &added, const QStringList &removed);
+    void refreshed(int count); // Nach rescan() und nach dem ersten Scan
+
+private:
+    void scan(); // Liste neu einlesen und Unterschiede melden
+
+    QHash<QString, Port> cache;             // Ports des letzten Scans nach Name
+    QFileSystemWatcher *watcher = nullptr;  // Nur Linux: /dev
+    QTimer *debounceTimer = nullptr;        // Fasst die Einträge eines Geräts in /dev zusammen
+    QTimer *pollTimer = nullptr;            // Ohne /dev: regelmäßiger Scan
+
+    static constexpr int DebounceMs = 300;      // udev legt Knoten, Rechte und Links nacheinander an
+    static constexpr int PollIntervalMs = 2000;
+};
+
+#endif // PORTWATCHER_H
@@ -0,0 +1,199 @@
+#include "protocol.h"
+#include <QtEndian>
+#include <cstring>
+
+namespace Protocol
+{
+
+// Zeichenvorrat der gepackten Dezimaldarstellung, Index = Nibble-Wert, 0xF = Füllwert
+static const char NibbleChars[] = "0123456789.-+*/";
+constexpr quint8 NibblePad = 0xF;
+
+quint8 crc8(const char *data, int length, quint8 crc)
+{
+    for (int i = 0; i < length; i++)
+    {
+        crc ^= static_cast<quint8>(data[i]);
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc & 0x80) ? static_cast<quint8>((crc << 1) ^ 0x07) : static_cast<quint8>(crc << 1);
+    }
+    return crc;
+}
+
+QByteArray encodeFrame(quint8 seq, quint8 opcode, const QByteArray &payload)
+{
+    QByteArray frame;
+    frame.reserve(Overhead + payload.size());
+    frame.append(static_cast<char>(Sync));
+    frame.append(static_cast<char>(payload.size()));
+    frame.append(static_cast<char>(seq));
+    frame.append(static_cast<char>(opcode));
+    frame.append(payload);
+    frame.append(static_cast<char>(crc8(frame.constData() + 1, frame.size() - 1))); // ohne SYNC
+    return frame;
+}
+
+bool packDecimal(const QString &text, QByteArray &packed)
+{
+    packed.clear();
+    packed.reserve((text.size() + 1) / 2);
+    quint8 current = 0;
+    bool high = true;
+
+    for (const QChar ch : text)
+    {
+        if (ch.isSpace()) // Leerzeichen um den Operator trägt keine Information
+            continue;
+        const char *pos = ch.unicode() < 128 ? strchr(NibbleChars, ch.toLatin1()) : nullptr;
+        if (pos == nullptr || ch.unicode() == 0)
+            return false;
+
+        const quint8 nibble = static_cast<quint8>(pos - NibbleChars);
+        if (high)
+        {
+            current = static_cast<quint8>(nibble << 4);
+        }
+        else
+        {
+            packed.append(static_cast<char>(current | nibble));
+        }
+        high = !high;
+    }
+    if (!high)
+        packed.append(static_cast<char>(current | NibblePad));
+    return true;
+}
+
+QString unpackDecimal(const QByteArray &packed)
+{
+    QString text;
+    text.reserve(packed.size() * 2);
+    for (const char byte : packed)
+    {
+        const quint8 nibbles[2] = {static_cast<quint8>(static_cast<quint8>(byte) >> 4), static_cast<quint8>(byte & 0x0F)};
+        for (const quint8 nibble : nibbles)
+        {
+            if (nibble == NibblePad)
+                return text;
+            text += QLatin1Char(NibbleChars[nibble]);
+        }
+    }
+    return text;
+}
+
+// Das Gerät schickt "15.5" statt "15.5000"; hier wird die gewohnte Darstellung wiederhergestellt
+QString formatResult(const QString &trimmed)
+{
+    QString result = trimmed;
+    int dot = result.indexOf('.');
+    if (dot < 0)
+    {
+        result += '.';
+        dot = result.size() - 1;
+    }
+    const int decimals = result.size() - dot - 1;
+    if (decimals < DecimalPlaces)
+        result += QString(DecimalPlaces - decimals, '0');
+    return result;
+}
+
+QString errorText(quint8 code)
+{
+    switch (code)
+    {
+    case ErrNoOperator:
+        return "Error: operation not found";
+    case ErrDivByZero:
+        return "Error: divison by 0"; // Schreibweise wie im Sketch
+    case ErrCrc:
+        return "Error: corrupted frame";
+    case ErrUnknownOp:
+        return "Error: unknown opcode";
+    case ErrBadPayload:
+        return "Error: invalid payload";
+    case ErrBadBytecode:
+        return "Error: invalid bytecode";
+    default:
+        return QString("Error: code %1").arg(code);
+    }
+}
+
+void appendFloat(QByteArray &bytes, float value)
+{
+    quint32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    char raw[4];
+    qToLittleEndian(bits, raw);
+    bytes.append(raw, sizeof(raw));
+}
+
+bool readFloat(const QByteArray &bytes, int offset, float &value)
+{
+    if (offset < 0 || offset + 4 > bytes.size())
+        return false;
+    const quint32 bits = qFromLittleEndian<quint32>(bytes.constData() + offset);
+    memcpy(&value, &bits, sizeof(value));
+    return true;
+}
+
+QList<Frame> FrameParser::feed(const QByteArray &data)
+{
+    QList<Frame> frames;
+    buffer += data;
+
+    while (!buffer.isEmpty())
+    {
+        // Bis zum nächsten Sync-Byte vorspulen
+        const int start = buffer.indexOf(static_cast<char>(Sync));
+        if (start < 0)
+        {
+            buffer.clear();
+            break;
+        }
+        if (start > 0)
+            buffer.remove(0, start);
+
+        if (buffer.size() < HeaderSize)
+            break;
+
+        // Lange Rahmen gibt es nur für Batches. Sonst würde ein verirrtes 0xA5 vor dem echten
+        // Sync-Byte LEN=165 ergeben und echte Antworten zurückhalten, bis 170 Bytes da sind.
+        const int length = static_cast<quint8>(buffer[1]);
+        const quint8 opcode = static_cast<quint8>(buffer[3]);
+        const bool batch = opcode == OpCalcBatch || opcode == OpResultBatch;
+        if (length > (batch ? MaxBatchPayload : MaxPayload)) // Kann kein gültiger Rahmen sein: Sync-Byte verwerfen
+        {
+            buffer.remove(0, 1);
+            continue;
+        }
+        if (buffer.size() < length + Overhead)
+            break;
+
+        Frame frame;
+        frame.seq = static_cast<quint8>(buffer[2]);
+        frame.opcode = opcode;
+        frame.payload = buffer.mid(HeaderSize, length);
+        const quint8 crc = crc8(buffer.constData() + 1, length + HeaderSize - 1);
+        frame.crcValid = crc == static_cast<quint8>(buffer[HeaderSize + length]);
+
+        if (frame.crcValid)
+        {
+            buffer.remove(0, length + Overhead);
+        }
+        else
+        {
+            // Nur das Sync-Byte verwerfen, falls LEN selbst beschädigt war
+            crcErrorCount++;
+            buffer.remove(0, 1);
+        }
+        frames.append(frame);
+    }
+    return frames;
+}
+
+void FrameParser::reset()
+{
+    buffer.clear();
+}
+
+}
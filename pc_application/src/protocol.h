@@ -0,0 +1,114 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <QByteArray>
+#include <QString>
+#include <QList>
+
+// Binäres Rahmenprotokoll zwischen PC und Arduino (Gegenstück in arduino_main.ino)
+//
+//   [SYNC 0xA5][LEN][SEQ][OP][PAYLOAD: LEN Bytes][CRC-8]
+//
+// LEN ist die Länge der Nutzdaten, SEQ die Sequenznummer der Anfrage (die Antwort
+// trägt dieselbe Nummer), die CRC-8 (Polynom 0x07) läuft über LEN, SEQ, OP und PAYLOAD.
+// Zahlen werden als gepackte Dezimalziffern übertragen: zwei Zeichen pro Byte. Mit
+// FeatureF32 gehen Operanden und Ergebnisse auch als float (IEEE-754, little endian)
+// über die Leitung; dann liest und formatiert nur der PC Dezimalzahlen. OpCalcBatch
+// bündelt bis zu MaxBatchCount Rechnungen in einem Rahmen, der dafür größer sein darf.
+namespace Protocol
+{
+    constexpr quint8 Sync = 0xA5;
+    constexpr int HeaderSize = 4;   // SYNC, LEN, SEQ, OP
+    constexpr int Overhead = 5;     // Header + CRC
+    constexpr int MaxPayload = 48;  // Außer OpCalcBatch: Grenze für entpackten Ausdruck und Antwort im Arduino
+    constexpr int MaxBatchCount = 24;                        // Rechnungen pro OpCalcBatch (RAM des Arduino)
+    constexpr int MaxBatchPayload = 2 + MaxBatchCount * 9;   // 218, größter Rahmen überhaupt
+
+    // Opcodes PC -> Arduino
+    constexpr quint8 OpCalc = 0x01; // Nutzdaten: gepackter Ausdruck "a<op>b"
+    constexpr quint8 OpPing = 0x02; // Heartbeat, keine Nutzdaten
+    constexpr quint8 OpHello = 0x03;   // Fragt Protokollversion und Fähigkeiten ab
+    constexpr quint8 OpSetBaud = 0x04; // Nutzdaten: Index in BaudRates, Gerät bestätigt noch mit alter Rate
+    constexpr quint8 OpEcho = 0x05;    // Nutzdaten werden unverändert zurückgeschickt
+    constexpr quint8 OpExec = 0x06;    // Nutzdaten: Bytecode für die Stack-VM (siehe expressioncompiler.h)
+    constexpr quint8 OpCalcF32 = 0x07; // Nutzdaten: a (float), Operator (ASCII), b (float); Antwort OpResultF32
+    constexpr quint8 OpExecF32 = 0x08; // Nutzdaten wie OpExec; Antwort OpResultF32
+    constexpr quint8 OpCalcBatch = 0x09; // Anzahl, gemeinsamer Operator oder 0, je Rechnung [Operator] a b (float); Antwort OpResultBatch
+    constexpr quint8 OpCommitBaud = 0x0A; // Echo mit neuer Rate erhalten: Gerät beendet die Probezeit, Antwort OpAck
+
+    // Opcodes Arduino -> PC
+    constexpr quint8 OpResult = 0x81;     // Nutzdaten: gepacktes Ergebnis ohne Nullen am Ende
+    constexpr quint8 OpResultText = 0x82; // Nutzdaten: Ergebnis als ASCII (z.B. "INF")
+    constexpr quint8 OpPong = 0x83;       // Antwort auf OpPing, keine Nutzdaten
+    constexpr quint8 OpHelloReply = 0x84; // Nutzdaten: Version, Features (16 Bit LE), Maske der Baudraten
+    constexpr quint8 OpAck = 0x85;        // Bestätigung ohne Nutzdaten
+    constexpr quint8 OpEchoReply = 0x86;  // Nutzdaten wie in OpEcho
+    constexpr quint8 OpResultF32 = 0x87;  // Nutzdaten: Ergebnis als float (4 Byte)
+    constexpr quint8 OpResultBatch = 0x88; // Nutzdaten: Anzahl, Fehlermaske (1 Bit je Rechnung), je Rechnung float oder Fehlercode
+    constexpr quint8 OpError = 0xE0;      // Nutzdaten: 1 Byte Fehlercode
+
+    // Fehlercodes für OpError
+    constexpr quint8 ErrNoOperator = 1; // "Error: operation not found"
+    constexpr quint8 ErrDivByZero = 2;  // "Error: divison by 0"
+    constexpr quint8 ErrCrc = 3;        // Rahmen mit falscher Prüfsumme empfangen
+    constexpr quint8 ErrUnknownOp = 4;  // Unbekannter Opcode
+    constexpr quint8 ErrBadPayload = 5; // Nutzdaten nicht dekodierbar
+    constexpr quint8 ErrBadBytecode = 6; // Stacküberlauf oder ungültiger Befehl in der VM
+
+    // Fähigkeiten der Firmware (Bitmaske in OpHelloReply)
+    constexpr quint16 FeatureFramed = 0x0001;   // Rahmenprotokoll
+    constexpr quint16 FeaturePing = 0x0002;     // OpPing / OpPong
+    constexpr quint16 FeatureBaudRate = 0x0004; // OpSetBaud / OpEcho / OpCommitBaud
+    constexpr quint16 FeatureVm = 0x0008;       // OpExec
+    constexpr quint16 FeatureF32 = 0x0010;      // OpCalcF32 / OpExecF32 / OpResultF32
+    constexpr quint16 FeatureBatch = 0x0020;    // OpCalcBatch / OpResultBatch
+
+    // Aushandelbare Baudraten, Index = Bit in der Maske aus OpHelloReply
+    constexpr qint32 BaudRates[] = {9600, 115200, 250000, 500000, 1000000};
+    constexpr int BaudRateCount = sizeof(BaudRates) / sizeof(BaudRates[0]);
+    constexpr qint32 DefaultBaudRate = 9600; // Rate nach dem Reset des Arduino
+
+    struct DeviceInfo
+    {
+        quint8 version = 0;   // 0: Gerät kennt das Rahmenprotokoll nicht
+        quint16 features = 0; // Feature-Bitmaske
+        quint8 baudMask = 1;  // Unterstützte Baudraten (Bit i = BaudRates[i])
+
+        bool has(quint16 feature) const { return (features & feature) == feature; }
+    };
+
+    constexpr int DecimalPlaces = 4; // Nachkommastellen wie String(result, 4) auf dem Arduino
+
+    struct Frame
+    {
+        quint8 seq = 0;
+        quint8 opcode = 0;
+        QByteArray payload;
+        bool crcValid = true; // false: Rahmen beschädigt, auch seq ist unzuverlässig
+    };
+
+    quint8 crc8(const char *data, int length, quint8 crc = 0);        // CRC-8, Polynom 0x07
+    QByteArray encodeFrame(quint8 seq, quint8 opcode, const QByteArray &payload);
+    bool packDecimal(const QString &text, QByteArray &packed);        // Überspringt Leerzeichen, false bei nicht darstellbaren Zeichen
+    QString unpackDecimal(const QByteArray &packed);
+    QString formatResult(const QString &trimmed);                     // Ergänzt wieder auf 4 Nachkommastellen
+    QString errorText(quint8 code);                                   // Fehlermeldung wie im Textprotokoll
+    void appendFloat(QByteArray &bytes, float value);                 // 4 Byte IEEE-754, little endian
+    bool readFloat(const QByteArray &bytes, int offset, float &value); // false, wenn die Bytes nicht reichen
+
+    // Zerlegt einen Bytestrom inkrementell in Rahmen und synchronisiert sich nach Fehlern neu
+    class FrameParser
+    {
+    public:
+        QList<Frame> feed(const QByteArray &data); // Liefert alle vollständig empfangenen Rahmen
+        void reset();
+        int crcErrors() const { return crcErrorCount; }
+        bool hasPartial() const { return !buffer.isEmpty(); } // Angefangener Rahmen im Puffer
+
+    private:
+        QByteArray buffer;
+        int crcErrorCount = 0;
+    };
+}
+
+#endif // PROTOCOL_H
@@ -0,0 +1,854 @@
+#include "requestengine.h"
+#include "expression.h"
+#include "expressioncompiler.h"
+#include "hostevaluator.h"
+#include <algorithm>
+
+namespace
+{
+    // Nur diese Fehler hängen vom Ausdruck ab; alle anderen von Kodierung und Übertragung
+    // (z.B. ErrBadPayload nach dem Umschalten auf float-Rahmen) und gehören nicht in den Cache
+    bool isExpressionError(quint8 code)
+    {
+        return code == Protocol::ErrDivByZero || code == Protocol::ErrNoOperator;
+    }
+}
+
+RequestEngine::RequestEngine(QSerialPort *serial, QObject *parent)
+    : QObject(parent), serial(serial), timeoutTimer(new QTimer(this))
+{
+    timeoutTimer->setSingleShot(true);
+    clock.start();
+    resultCache.setMaxCost(DefaultCacheSize);
+
+    connect(serial, &QSerialPort::readyRead, this, &RequestEngine::onReadyRead);
+    connect(timeoutTimer, &QTimer::timeout, this, &RequestEngine::onTimeout);
+    connect(serial, &QSerialPort::bytesWritten, this, &RequestEngine::onBytesWritten);
+}
+
+// Neue Berechnung anhängen und sofort senden, falls im Fenster noch Platz ist.
+// Bereits bekannte Ausdrücke werden aus dem Cache beantwortet, ohne das Gerät zu fragen,
+// und je nach OffloadPolicy direkt auf dem PC gerechnet.
+quint32 RequestEngine::enqueue(const QString &expression, qint64 validatedAt)
+{
+    return enqueue(expression, Expression::parse(expression), validatedAt);
+}
+
+quint32 RequestEngine::enqueue(const QString &expression, const Expression::Parsed &parsed, qint64 validatedAt)
+{
+    Request request;
+    request.id = nextId++;
+    request.times.validatedAt = validatedAt;
+    request.times.queuedAt = clock.nsecsElapsed();
+
+    if (resultCache.maxCost() > 0)
+    {
+        request.cacheKey = Expression::canonical(expression);
+        if (const QString *cached = resultCache.object(request.cacheKey))
+        {
+            cacheHitCount++;
+            answerLater(request.id, expression, *cached, request.times);
+            return request.id;
+        }
+        cacheMissCount++;
+    }
+
+    if (shouldOffload())
+    {
+        hostCount++;
+        answerLater(request.id, expression, HostEvaluator::evaluate(expression, parsed), request.times);
+        return request.id;
+    }
+
+    request.command = false;
+    request.opcode = Protocol::OpCalc;
+    request.expression = expression;
+    request.parsed = parsed;
+    request.sentAt = 0;
+    request.writeEnd = 0;
+    request.seq = 0;
+    request.retries = 0;
+    waiting.enqueue(request);
+    schedulePump(); // Erst nach Rückkehr senden, damit der Aufrufer die ID vor allen Signalen kennt
+    return request.id;
+}
+
+// Steuerrahmen (z.B. Heartbeat) laufen durch dieselbe Warteschlange wie Berechnungen
+quint32 RequestEngine::sendCommand(quint8 opcode, const QByteArray &payload)
+{
+    Request request;
+    request.id = nextId++;
+    request.command = true;
+    request.opcode = opcode;
+    request.payload = payload;
+    request.sentAt = 0;
+    request.writeEnd = 0;
+    request.seq = 0;
+    request.retries = 0;
+    waiting.enqueue(request);
+    schedulePump();
+    return request.id;
+}
+
+// Alle offenen Anfragen verwerfen, z.B. nach einem Verbindungsabbruch.
+// Außer bei DeviceOnly werden Berechnungen stattdessen auf dem PC beantwortet.
+void RequestEngine::clear()
+{
+    timeoutTimer->stop();
+    const QList<Request> dropped = inFlight + waiting;
+    inFlight.clear();
+    waiting.clear();
+    rxBuffer.clear();
+    frameParser.reset();
+    partialSince = -1;
+    expiredSeqs.clear();
+    bytesFlushed = bytesQueued; // Nicht mehr abgegebene Bytes werden nie gemeldet
+    inFlightBytes = 0;
+
+    for (const Request &request : dropped)
+    {
+        if (!offload(request))
+            notifyFailed(request, "Request cancelled.");
+    }
+    checkIdle();
+}
+
+void RequestEngine::discardInput()
+{
+    rxBuffer.clear();
+    frameParser.reset();
+    partialSince = -1;
+}
+
+void RequestEngine::setWireMode(WireMode mode)
+{
+    this->mode = mode;
+    for (Request &request : waiting) // Bereits kodierte Anfragen neu kodieren
+        request.wire.clear();
+    rxBuffer.clear();
+    frameParser.reset();
+}
+
+void RequestEngine::setDeviceFeatures(quint16 features)
+{
+    this->features = features;
+    resultCache.clear(); // Anderes Gerät oder andere Firmware: alte Antworten nicht übernehmen
+    rttEwmaUs = 0;
+    stalledSince = -1;
+}
+
+RequestEngine::WireMode RequestEngine::wireMode() const
+{
+    return mode;
+}
+
+void RequestEngine::setMaxInFlight(int count)
+{
+    windowSize = qBound(1, count, MaxWindowSize);
+    pump();
+}
+
+int RequestEngine::maxInFlight() const
+{
+    return windowSize;
+}
+
+void RequestEngine::setTimeout(int ms)
+{
+    timeoutMs = qMax(1, ms);
+}
+
+int RequestEngine::timeout() const
+{
+    return timeoutMs;
+}
+
+int RequestEngine::pendingCount() const
+{
+    int count = waiting.size() + inFlight.size() + answersPending;
+    for (const Request &request : inFlight)
+    {
+        if (!request.batch.empty())
+            count += static_cast<int>(request.batch.size()) - 1;
+    }
+    if (!waiting.isEmpty() && !waiting.head().batch.empty()) // Gebündelt wird nur am Anfang der Warteschlange
+        count += static_cast<int>(waiting.head().batch.size()) - 1;
+    return count;
+}
+
+bool RequestEngine::isBusy() const
+{
+    return pendingCount() > 0;
+}
+
+void RequestEngine::setBinaryFloats(bool enabled)
+{
+    floatWire = enabled;
+}
+
+bool RequestEngine::binaryFloats() const
+{
+    return floatWire;
+}
+
+void RequestEngine::setMaxBatchSize(int count)
+{
+    maxBatch = qBound(1, count, Protocol::MaxBatchCount);
+}
+
+int RequestEngine::batchCapacity() const
+{
+    return mode == Framed && (features & Protocol::FeatureBatch) ? maxBatch : 1;
+}
+
+void RequestEngine::setCacheSize(int entries)
+{
+    resultCache.setMaxCost(qMax(0, entries)); // Verkleinern verdrängt die ältesten Einträge
+}
+
+int RequestEngine::cacheSize() const
+{
+    return static_cast<int>(resultCache.maxCost());
+}
+
+void RequestEngine::clearCache()
+{
+    resultCache.clear();
+}
+
+quint64 RequestEngine::cacheHits() const
+{
+    return cacheHitCount;
+}
+
+quint64 RequestEngine::cacheMisses() const
+{
+    return cacheMissCount;
+}
+
+void RequestEngine::setOffloadPolicy(OffloadPolicy policy)
+{
+    this->policy = policy;
+}
+
+RequestEngine::OffloadPolicy RequestEngine::offloadPolicy() const
+{
+    return policy;
+}
+
+void RequestEngine::setOffloadBudget(int ms)
+{
+    offloadBudgetUs = qMax(0, ms) * qint64(1000);
+}
+
+quint64 RequestEngine::hostEvaluations() const
+{
+    return hostCount;
+}
+
+qint64 RequestEngine::deviceRttUs() const
+{
+    return static_cast<qint64>(rttEwmaUs);
+}
+
+qint64 RequestEngine::elapsedNs() const
+{
+    return clock.nsecsElapsed();
+}
+
+// Wie bei gesendeten Anfragen kommt die Antwort erst nach Rückkehr von enqueue()
+void RequestEngine::answerLater(quint32 id, const QString &expression, const QString &response, StageTimes times)
+{
+    answersPending++;
+    QMetaObject::invokeMethod(this, [this, id, expression, response, times]() mutable {
+        answersPending--;
+        times.completedAt = clock.nsecsElapsed();
+        emit requestTimed(id, times);
+        emit responseReceived(id, expression, response);
+        checkIdle();
+    }, Qt::QueuedConnection);
+}
+
+// Schätzt die Wartezeit einer neuen Anfrage aus der geglätteten Antwortzeit und der
+// Anzahl der Anfragen davor. Pro Fenster läuft eine Antwortzeit ab.
+bool RequestEngine::shouldOffload() const
+{
+    switch (policy)
+    {
+    case DeviceOnly:
+        return false;
+    case HostOnly:
+        return true;
+    default:
+        break;
+    }
+    if (!serial->isOpen() || !serial->isWritable())
+        return true;
+    if (stalledSince >= 0 && clock.elapsed() - stalledSince < timeoutMs) // Danach das Gerät erneut versuchen
+        return true;
+    if (rttEwmaUs <= 0) // Noch keine Messung: erst das Gerät fragen
+        return false;
+    const double rounds = static_cast<double>(waiting.size() + inFlight.size()) / windowSize + 1;
+    return rttEwmaUs * rounds > offloadBudgetUs;
+}
+
+// Berechnung, die das Gerät nicht beantworten kann, auf dem PC abschließen
+bool RequestEngine::offload(const Request &request)
+{
+    if (request.command || policy == DeviceOnly)
+        return false;
+    for (const Request &member : request.batch)
+        offload(member);
+    if (!request.batch.empty())
+        return true;
+    hostCount++;
+    const QString response = HostEvaluator::evaluate(request.expression, request.parsed);
+    StageTimes times = request.times;
+    times.completedAt = clock.nsecsElapsed();
+    emit requestTimed(request.id, times);
+    emit responseReceived(request.id, request.expression, response);
+    return true;
+}
+
+// Mehrere enqueue()-Aufrufe hintereinander werden in einem Durchlauf gesendet
+void RequestEngine::schedulePump()
+{
+    if (pumpScheduled)
+        return;
+    pumpScheduled = true;
+    QMetaObject::invokeMethod(this, [this]() {
+        pumpScheduled = false;
+        pump();
+    }, Qt::QueuedConnection);
+}
+
+// Sendet so viele wartende Anfragen wie erlaubt. Neben der Anzahl wird auch die Summe
+// der Bytes begrenzt, damit der 64-Byte-Empfangspuffer des Arduino nicht überläuft.
+void RequestEngine::pump()
+{
+    if (!serial->isOpen() || !serial->isWritable())
+        return;
+
+    while (!waiting.isEmpty() && inFlight.size() < windowSize)
+    {
+        // Jede gesendete Anfrage belegt eine Sequenznummer, ohne freie wird nicht kodiert
+        if (mode == Framed && waiting.head().wire.isEmpty() && inFlight.size() >= SeqCount)
+            break;
+        if (waiting.head().wire.isEmpty() && batchCapacity() > 1)
+            gatherBatch();
+        Request &next = waiting.head();
+        if (next.wire.isEmpty() && !encode(next))
+        {
+            const Request request = waiting.dequeue();
+            if (!offload(request))
+                notifyFailed(request, "Expression is not supported by the device.");
+            continue;
+        }
+
+        const int size = next.wire.size();
+        if (!inFlight.isEmpty() && inFlightBytes + size > DeviceRxBufferSize)
+            break;
+
+        Request request = waiting.dequeue();
+        serial->write(request.wire);
+        bytesQueued += size;
+        request.writeEnd = bytesQueued;
+        request.sentAt = clock.elapsed();
+        request.times.writtenAt = clock.nsecsElapsed();
+        inFlightBytes += size;
+        inFlight.append(request);
+        for (const Request &member : request.batch)
+            emit requestSent(member.id, member.expression);
+        if (!request.command && request.batch.empty())
+            emit requestSent(request.id, request.expression);
+    }
+
+    if (!inFlight.isEmpty() && !timeoutTimer->isActive())
+        armTimeout();
+}
+
+// Einfache Rechnungen am Anfang der Warteschlange wandern in eine Sammelanfrage, die
+// ihren Platz einnimmt. Reihenfolge und Steuerrahmen bleiben unberührt; eine einzelne
+// Rechnung geht weiter als eigener Rahmen.
+void RequestEngine::gatherBatch()
+{
+    auto batchable = [](const Request &request) {
+        return !request.command && request.parsed.simple && request.batch.empty();
+    };
+    int count = 0;
+    while (count < waiting.size() && count < maxBatch && batchable(waiting[count]))
+        count++;
+    if (count < 2)
+        return;
+
+    Request batch;
+    batch.id = 0; // Nach außen zählen nur die IDs der gebündelten Rechnungen
+    batch.command = false;
+    batch.opcode = Protocol::OpCalcBatch;
+    batch.sentAt = 0;
+    batch.writeEnd = 0;
+    batch.seq = 0;
+    batch.retries = 0;
+    batch.times.queuedAt = clock.nsecsElapsed();
+    batch.batch.reserve(count);
+    for (int i = 0; i < count; i++)
+        batch.batch.push_back(waiting.dequeue());
+    waiting.prepend(batch);
+}
+
+// Erzeugt die Bytes für den aktuellen Protokollmodus
+bool RequestEngine::encode(Request &request)
+{
+    if (!request.batch.empty())
+    {
+        if (mode == TextLines || !(features & Protocol::FeatureBatch)) // Protokoll nachträglich geändert
+            return false;
+        encodeBatch(request);
+        return true;
+    }
+
+    if (mode == TextLines)
+    {
+        if (request.command || !request.parsed.simple) // Weder Steuerrahmen noch Bytecode
+            return false;
+        request.wire = request.expression.toUtf8() + '\n'; // **Newline für Arduino!**
+        return true;
+    }
+
+    if (request.command)
+    {
+        if (request.payload.size() > Protocol::MaxPayload)
+            return false;
+        request.seq = allocateSeq();
+        request.wire = Protocol::encodeFrame(request.seq, request.opcode, request.payload);
+        return true;
+    }
+
+    // Einfache Ausdrücke als gepackter Text, der Rest als Bytecode für die VM.
+    // Mit floatWire gehen die bereits zerlegten Operanden binär hinaus.
+    QByteArray payload;
+    quint8 opcode = Protocol::OpCalc;
+    const bool f32 = floatWire && (features & Protocol::FeatureF32);
+    if (request.parsed.simple && f32)
+    {
+        payload.reserve(9);
+        Protocol::appendFloat(payload, request.parsed.left);
+        payload.append(request.parsed.op);
+        Protocol::appendFloat(payload, request.parsed.right);
+        opcode = Protocol::OpCalcF32;
+    }
+    else if (request.parsed.simple)
+    {
+        if (!Protocol::packDecimal(request.expression, payload))
+            return false;
+    }
+    else
+    {
+        if (!(features & Protocol::FeatureVm))
+            return false;
+        const CompiledExpression compiled = ExpressionCompiler::compile(request.expression);
+        if (compiled.status != CompiledExpression::Ok)
+            return false;
+        payload = compiled.bytecode;
+        opcode = f32 ? Protocol::OpExecF32 : Protocol::OpExec;
+    }
+    if (payload.size() > Protocol::MaxPayload)
+        return false;
+    request.seq = allocateSeq();
+    request.wire = Protocol::encodeFrame(request.seq, opcode, payload);
+    return true;
+}
+
+// [Anzahl][Operator] und je Rechnung a, b als float, wenn alle denselben Operator haben,
+// sonst [Anzahl][0] und je Rechnung Operator, a, b
+void RequestEngine::encodeBatch(Request &request)
+{
+    const char shared = request.batch.front().parsed.op;
+    const bool sameOperator = std::all_of(request.batch.begin(), request.batch.end(),
+                                          [shared](const Request &member) { return member.parsed.op == shared; });
+    QByteArray payload;
+    payload.reserve(Protocol::MaxBatchPayload);
+    payload.append(static_cast<char>(request.batch.size()));
+    payload.append(sameOperator ? shared : '\0');
+    for (const Request &member : request.batch)
+    {
+        if (!sameOperator)
+            payload.append(member.parsed.op);
+        Protocol::appendFloat(payload, member.parsed.left);
+        Protocol::appendFloat(payload, member.parsed.right);
+    }
+    request.seq = allocateSeq();
+    request.wire = Protocol::encodeFrame(request.seq, Protocol::OpCalcBatch, payload);
+}
+
+void RequestEngine::onReadyRead()
+{
+    const qint64 receivedAt = clock.nsecsElapsed();
+    const QByteArray data = serial->readAll();
+    if (!data.isEmpty())
+    {
+        stalledSince = -1; // Gerät antwortet wieder
+        lastReceivedAt = clock.elapsed();
+    }
+    if (mode == TextLines)
+    {
+        rxBuffer += data;
+        handleLines(receivedAt);
+    }
+    else
+    {
+        handleFrames(data, receivedAt);
+    }
+
+    armTimeout();
+    pump();
+    checkIdle();
+}
+
+// Das Gerät antwortet in Empfangsreihenfolge: jede vollständige Zeile gehört
+// zur ältesten gesendeten Anfrage
+void RequestEngine::handleLines(qint64 receivedAt)
+{
+    // Die erste Zeile hat schon mit einem früheren readyRead begonnen, alle weiteren mit diesem
+    qint64 lineStart = partialSince >= 0 ? partialSince : receivedAt;
+    int lineEnd;
+    while ((lineEnd = findLineEnd(rxBuffer)) >= 0)
+    {
+        const QByteArray line = rxBuffer.left(lineEnd).trimmed();
+        rxBuffer.remove(0, lineEnd + 1);
+        if (line.isEmpty()) // "\r\n" von Serial.println erzeugt eine leere Restzeile
+            continue;
+        const qint64 firstByteAt = lineStart;
+        lineStart = receivedAt;
+        if (inFlight.isEmpty()) // Antwort ohne Anfrage (z.B. nach Timeout) verwerfen
+            continue;
+
+        // Fortschritt: Timeout für die nächste Anfrage läuft ab jetzt
+        if (inFlight.size() > 1)
+            inFlight[1].sentAt = qMax(inFlight[1].sentAt, clock.elapsed());
+        inFlight[0].times.firstByteAt = firstByteAt;
+        const QString response = QString::fromUtf8(line);
+        finish(0, response, response != "Error: input too long"); // Zu lange Zeile: Kodierung, nicht Ausdruck
+    }
+    partialSince = rxBuffer.trimmed().isEmpty() ? -1 : lineStart;
+}
+
+// Jede Antwort trägt die Sequenznummer ihrer Anfrage, die Reihenfolge spielt keine Rolle.
+// Beschädigte Rahmen werden nur gezählt (FrameParser::crcErrors): ihre Sequenznummer stammt
+// aus denselben kaputten Bytes. Wiederholt wird nach ERR_CRC vom Gerät oder dem Timeout.
+void RequestEngine::handleFrames(const QByteArray &data, qint64 receivedAt)
+{
+    // Der erste Rahmen kann schon mit einem früheren readyRead begonnen haben
+    qint64 frameStart = partialSince >= 0 ? partialSince : receivedAt;
+    const QList<Protocol::Frame> frames = frameParser.feed(data);
+    partialSince = frameParser.hasPartial() ? (frames.isEmpty() ? frameStart : receivedAt) : -1;
+    for (const Protocol::Frame &frame : frames)
+    {
+        const qint64 firstByteAt = frameStart;
+        frameStart = receivedAt;
+        if (!frame.crcValid)
+            continue;
+        const int index = findInFlight(frame.seq);
+        if (index < 0) // Verspätete oder doppelte Antwort
+            continue;
+        inFlight[index].times.firstByteAt = firstByteAt;
+
+        if (!inFlight[index].batch.empty())
+        {
+            const quint8 code = frame.payload.isEmpty() ? 0 : static_cast<quint8>(frame.payload[0]);
+            if (frame.opcode == Protocol::OpResultBatch)
+                finishBatch(index, frame.payload);
+            else if (frame.opcode == Protocol::OpError && code == Protocol::ErrCrc)
+                retransmit(index);
+            else // Fehler betrifft den ganzen Rahmen, nicht die einzelnen Rechnungen: nicht cachen
+                fail(index, frame.opcode == Protocol::OpError ? Protocol::errorText(code)
+                                                              : QString("Unexpected opcode 0x%1.").arg(frame.opcode, 2, 16, QChar('0')));
+            continue;
+        }
+
+        if (inFlight[index].command)
+        {
+            if (frame.opcode == Protocol::OpError && !frame.payload.isEmpty() && static_cast<quint8>(frame.payload[0]) == Protocol::ErrCrc)
+            {
+                retransmit(index);
+                continue;
+            }
+            const Request request = inFlight.takeAt(index);
+            inFlightBytes -= request.wire.size();
+            emit commandReplied(request.id, frame.opcode, frame.payload);
+            continue;
+        }
+
+        switch (frame.opcode)
+        {
+        case Protocol::OpResult:
+            finish(index, Protocol::formatResult(Protocol::unpackDecimal(frame.payload)));
+            break;
+        case Protocol::OpResultF32:
+        {
+            float value;
+            if (Protocol::readFloat(frame.payload, 0, value))
+                finish(index, HostEvaluator::formatResult(value)); // Wie dtostrf(result, 6, 4) im Sketch
+            else
+                fail(index, Protocol::errorText(Protocol::ErrBadPayload));
+            break;
+        }
+        case Protocol::OpResultText:
+            finish(index, QString::fromLatin1(frame.payload).trimmed()); // dtostrf füllt "inf" auf 6 Zeichen auf
+            break;
+        case Protocol::OpError:
+        {
+            const quint8 code = frame.payload.isEmpty() ? 0 : static_cast<quint8>(frame.payload[0]);
+            if (code == Protocol::ErrCrc) // Anfrage kam beschädigt beim Gerät an
+                retransmit(index);
+            else
+                finish(index, Protocol::errorText(code), isExpressionError(code));
+            break;
+        }
+        default:
+            fail(index, QString("Unexpected opcode 0x%1.").arg(frame.opcode, 2, 16, QChar('0')));
+            break;
+        }
+    }
+}
+
+// Anfrage nach Übertragungsfehler erneut senden, das Gerät rechnet zustandslos
+void RequestEngine::retransmit(int index)
+{
+    Request &request = inFlight[index];
+    if (request.retries >= MaxRetries)
+    {
+        fail(index, "Corrupted response.");
+        return;
+    }
+    request.retries++;
+    request.sentAt = clock.elapsed();
+    request.times.firstByteAt = -1;
+    serial->write(request.wire);
+    bytesQueued += request.wire.size();
+}
+
+// Antworten des Geräts sind deterministisch, auch Fehlermeldungen wie die Division durch 0.
+// Timeouts und Abbrüche laufen über fail() und landen nie im Cache.
+void RequestEngine::finish(int index, const QString &response, bool cacheable)
+{
+    const Request request = inFlight.takeAt(index);
+    inFlightBytes -= request.wire.size();
+    deliver(request, response, complete(request), cacheable);
+}
+
+// Antwort: [Anzahl][Fehlermaske, ein Bit je Rechnung][je Rechnung 4 Byte]. Ein gesetztes
+// Bit bedeutet, dass die 4 Byte statt des floats im ersten Byte einen Fehlercode tragen.
+void RequestEngine::finishBatch(int index, const QByteArray &payload)
+{
+    const int count = static_cast<int>(inFlight[index].batch.size());
+    const int maskBytes = (count + 7) / 8;
+    if (payload.size() != 1 + maskBytes + 4 * count || static_cast<quint8>(payload[0]) != count)
+    {
+        fail(index, Protocol::errorText(Protocol::ErrBadPayload));
+        return;
+    }
+
+    const Request request = inFlight.takeAt(index);
+    inFlightBytes -= request.wire.size();
+    const StageTimes batchTimes = complete(request);
+    for (int i = 0; i < count; i++)
+    {
+        const Request &member = request.batch[i];
+        const int slot = 1 + maskBytes + 4 * i;
+        QString response;
+        bool cacheable = false;
+        float value;
+        if (static_cast<quint8>(payload[1 + i / 8]) & (1 << (i % 8)))
+        {
+            const quint8 code = static_cast<quint8>(payload[slot]);
+            response = Protocol::errorText(code);
+            cacheable = isExpressionError(code);
+        }
+        else if (Protocol::readFloat(payload, slot, value))
+        {
+            response = HostEvaluator::formatResult(value);
+            cacheable = true;
+        }
+
+        StageTimes times = member.times; // Eigene Warte-, gemeinsame Übertragungszeiten
+        times.writtenAt = batchTimes.writtenAt;
+        times.flushedAt = batchTimes.flushedAt;
+        times.firstByteAt = batchTimes.firstByteAt;
+        times.completedAt = batchTimes.completedAt;
+        deliver(member, response, times, cacheable);
+    }
+}
+
+StageTimes RequestEngine::complete(const Request &request)
+{
+    StageTimes times = request.times;
+    times.completedAt = clock.nsecsElapsed();
+    if (request.retries == 0) // Wiederholte Anfragen verfälschen die Antwortzeit
+    {
+        const double sample = (times.completedAt - times.writtenAt) / 1000.0;
+        rttEwmaUs = rttEwmaUs <= 0 ? sample : rttEwmaUs + (sample - rttEwmaUs) / 8;
+    }
+    return times;
+}
+
+void RequestEngine::deliver(const Request &request, const QString &response, const StageTimes &times, bool cacheable)
+{
+    if (cacheable && !request.command && !request.cacheKey.isEmpty() && resultCache.maxCost() > 0)
+        resultCache.insert(request.cacheKey, new QString(response));
+    emit requestTimed(request.id, times);
+    emit responseReceived(request.id, request.expression, response);
+}
+
+void RequestEngine::fail(int index, const QString &reason)
+{
+    const Request request = inFlight.takeAt(index);
+    inFlightBytes -= request.wire.size();
+    if (!offload(request))
+        notifyFailed(request, reason);
+}
+
+void RequestEngine::notifyFailed(const Request &request, const QString &reason)
+{
+    for (const Request &member : request.batch)
+        notifyFailed(member, reason);
+    if (!request.batch.empty())
+        return;
+    if (request.command)
+        emit commandFailed(request.id, reason);
+    else
+        emit requestFailed(request.id, request.expression, reason);
+}
+
+int RequestEngine::findInFlight(quint8 seq) const
+{
+    for (int i = 0; i < inFlight.size(); i++)
+    {
+        if (inFlight[i].seq == seq)
+            return i;
+    }
+    return -1;
+}
+
+// Sequenznummer 0 ist für unaufgeforderte Meldungen des Geräts reserviert. Nummern, deren
+// Anfrage vor weniger als timeoutMs abgelaufen ist, werden übersprungen, solange es andere gibt.
+// pump() sorgt dafür, dass nie alle SeqCount Nummern gleichzeitig gesendet sind.
+quint8 RequestEngine::allocateSeq()
+{
+    const qint64 now = clock.elapsed();
+    quint8 resting = 0; // Erste freie, aber noch ruhende Nummer als Notlösung
+    for (int attempt = 0; attempt < SeqCount; attempt++)
+    {
+        nextSeq = nextSeq == SeqCount ? 1 : nextSeq + 1;
+        if (findInFlight(nextSeq) >= 0)
+            continue;
+        const auto expired = expiredSeqs.constFind(nextSeq);
+        if (expired == expiredSeqs.cend())
+            return nextSeq;
+        if (now - *expired >= timeoutMs)
+        {
+            expiredSeqs.remove(nextSeq);
+            return nextSeq;
+        }
+        if (resting == 0)
+            resting = nextSeq;
+    }
+    expiredSeqs.remove(resting);
+    nextSeq = resting;
+    return nextSeq;
+}
+
+// Startet den Timer für die älteste gesendete Anfrage
+void RequestEngine::armTimeout()
+{
+    if (inFlight.isEmpty())
+    {
+        timeoutTimer->stop();
+        return;
+    }
+    qint64 oldest = inFlight.first().sentAt;
+    for (const Request &request : inFlight) // Wiederholte Anfragen haben neuere Zeitpunkte
+        oldest = qMin(oldest, request.sentAt);
+    const qint64 remaining = oldest + timeoutMs - clock.elapsed();
+    timeoutTimer->start(static_cast<int>(qMax<qint64>(0, remaining)));
+}
+
+void RequestEngine::onTimeout()
+{
+    if (mode == TextLines)
+    {
+        // Ohne Antwort ist die Zuordnung im Textprotokoll nicht mehr sicher,
+        // deshalb werden alle gesendeten Anfragen als fehlgeschlagen gemeldet
+        rxBuffer.clear();
+        while (!inFlight.isEmpty())
+            fail(0, "No response received!");
+    }
+    else
+    {
+        // Im Rahmenprotokoll betrifft ein Timeout nur die überfälligen Anfragen. Ihre
+        // Sequenznummern ruhen eine Weile, damit eine verspätete Antwort keine neue Anfrage
+        // trifft. Ein angefangener Rahmen wird nur verworfen, wenn seit timeoutMs kein Byte
+        // mehr kam; er kann sonst zu einer Anfrage gehören, die noch läuft.
+        const qint64 now = clock.elapsed();
+        for (int i = inFlight.size() - 1; i >= 0; i--)
+        {
+            if (inFlight[i].sentAt + timeoutMs <= now)
+            {
+                expiredSeqs.insert(inFlight[i].seq, now);
+                fail(i, "No response received!");
+            }
+        }
+        if (frameParser.hasPartial() && now - lastReceivedAt >= timeoutMs)
+        {
+            frameParser.reset();
+            partialSince = -1;
+        }
+    }
+
+    // Gerät hängt: wartende Berechnungen nicht hinter dem nächsten Timeout anstellen
+    if (policy != DeviceOnly)
+    {
+        stalledSince = clock.elapsed();
+        for (int i = 0; i < waiting.size();)
+        {
+            if (waiting[i].command)
+                i++;
+            else
+                offload(waiting.takeAt(i));
+        }
+    }
+
+    armTimeout();
+    pump();
+    checkIdle();
+}
+
+// Der Treiber meldet abgegebene Bytes in Schreibreihenfolge: jede Anfrage, deren letztes
+// Byte darin enthalten ist, gilt als gesendet
+void RequestEngine::onBytesWritten(qint64 bytes)
+{
+    bytesFlushed += bytes;
+    const qint64 now = clock.nsecsElapsed();
+    for (Request &request : inFlight)
+    {
+        if (request.times.flushedAt < 0 && request.writeEnd <= bytesFlushed)
+            request.times.flushedAt = now;
+    }
+}
+
+// Position des ersten '\n' oder '\r', -1 falls die Zeile noch unvollständig ist
+int RequestEngine::findLineEnd(const QByteArray &buffer)
+{
+    for (int i = 0; i < buffer.size(); i++)
+    {
+        if (buffer[i] == '\n' || buffer[i] == '\r')
+            return i;
+    }
+    return -1;
+}
+
+void RequestEngine::checkIdle()
+{
+    if (!isBusy())
+        emit idle();
+}
@@ -0,0 +1,165 @@
+#ifndef REQUESTENGINE_H
+#define REQUESTENGINE_H
+
+#include <QObject>
+#include <QSerialPort>
+#include <QQueue>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QCache>
+#include <QHash>
+#include <vector>
+#include "protocol.h"
+#include "expression.h"
+#include "latencystats.h"
+
+// Nicht-blockierende Anfrage-Engine: hält eine Warteschlange offener Berechnungen,
+// sendet bis zu N davon gleichzeitig und ordnet die Antworten über readyRead zu.
+// Kann das Gerät FeatureBatch, werden wartende einfache Rechnungen zu einem
+// OpCalcBatch-Rahmen gebündelt; nach außen bleibt jede Rechnung eine eigene Anfrage.
+class RequestEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum WireMode
+    {
+        TextLines, // Altes Protokoll: "a+b\n", Antworten in Sendereihenfolge
+        Framed     // Binäre Rahmen mit Sequenznummer und CRC (siehe protocol.h)
+    };
+
+    enum OffloadPolicy
+    {
+        DeviceOnly, // Alles an das Gerät, Fehler und Timeouts werden gemeldet
+        Adaptive,   // Auf dem PC rechnen, wenn das Gerät ausgelastet, hängt oder getrennt ist
+        HostOnly    // Alles auf dem PC rechnen
+    };
+
+    explicit RequestEngine(QSerialPort *serial, QObject *parent = nullptr);
+
+    quint32 enqueue(const QString &expression, qint64 validatedAt = -1); // Stellt eine Berechnung in die Warteschlange, liefert die Anfrage-ID
+    quint32 enqueue(const QString &expression, const Expression::Parsed &parsed, qint64 validatedAt = -1); // Bereits zerlegt, z.B. von check_input
+    quint32 sendCommand(quint8 opcode, const QByteArray &payload = QByteArray()); // Steuerrahmen (nur Rahmenprotokoll)
+    void clear();                               // Verwirft alle offenen Anfragen (z.B. bei Verbindungsabbruch)
+    void discardInput();                        // Verwirft teilweise empfangene Antworten (z.B. nach Baudratenwechsel)
+    void setWireMode(WireMode mode);            // Nur ändern, solange keine Anfragen offen sind
+    void setDeviceFeatures(quint16 features);   // Fähigkeiten aus dem Handshake (Protocol::Feature*)
+    WireMode wireMode() const;
+    void setMaxInFlight(int count);             // Maximale Anzahl gleichzeitig gesendeter Anfragen (1..254)
+    int maxInFlight() const;
+    void setTimeout(int ms);                    // Zeit bis eine Anfrage ohne Antwort als verloren gilt
+    int timeout() const;
+    int pendingCount() const;                   // Wartende + gesendete Anfragen
+    bool isBusy() const;                        // true, solange noch Anfragen offen sind
+    void setCacheSize(int entries);             // Maximale Anzahl gespeicherter Ergebnisse, 0 schaltet den Cache ab
+    int cacheSize() const;
+    void clearCache();                          // Gespeicherte Ergebnisse verwerfen (z.B. anderes Gerät)
+    quint64 cacheHits() const;                  // Direkt aus dem Cache beantwortete Anfragen
+    quint64 cacheMisses() const;                // Anfragen, die an das Gerät gehen mussten
+    void setOffloadPolicy(OffloadPolicy policy);
+    OffloadPolicy offloadPolicy() const;
+    void setOffloadBudget(int ms);              // Adaptive: erwartete Wartezeit auf das Gerät, ab der auf dem PC gerechnet wird
+    void setBinaryFloats(bool enabled);         // Zahlen als float statt als Text übertragen, falls das Gerät FeatureF32 kann
+    bool binaryFloats() const;
+    void setMaxBatchSize(int count);            // Rechnungen pro OpCalcBatch-Rahmen, 1 schaltet die Bündelung ab
+    int batchCapacity() const;                  // Rechnungen, die ein Rahmen beim aktuellen Gerät tragen kann
+    quint64 hostEvaluations() const;            // Auf dem PC beantwortete Anfragen
+    qint64 deviceRttUs() const;                 // Geglättete Antwortzeit des Geräts, 0 solange noch nicht gemessen
+    qint64 elapsedNs() const;                   // Monotone Uhr der Engine, Zeitbasis von StageTimes
+
+signals:
+    void requestSent(quint32 id, const QString &expression);                                // Anfrage wurde geschrieben
+    void responseReceived(quint32 id, const QString &expression, const QString &response); // Antwort zugeordnet
+    void requestFailed(quint32 id, const QString &expression, const QString &reason);      // Timeout oder Abbruch
+    void commandReplied(quint32 id, quint8 opcode, const QByteArray &payload);             // Antwort auf einen Steuerrahmen
+    void commandFailed(quint32 id, const QString &reason);                                 // Steuerrahmen ohne Antwort
+    void requestTimed(quint32 id, const StageTimes &times);                                // Zeitpunkte, direkt vor responseReceived
+    void idle();                                                                            // Keine offenen Anfragen mehr
+
+private slots:
+    void onReadyRead(); // Liest alle verfügbaren Bytes und ordnet vollständige Antworten zu
+    void onTimeout();   // Älteste gesendete Anfrage hat nicht rechtzeitig geantwortet
+    void onBytesWritten(qint64 bytes); // Markiert Anfragen, deren Bytes vollständig beim Treiber sind
+
+private:
+    struct Request
+    {
+        quint32 id;         // Fortlaufende Anfrage-ID
+        bool command;       // Steuerrahmen statt Berechnung
+        quint8 opcode;      // Opcode eines Steuerrahmens
+        QByteArray payload; // Nutzdaten eines Steuerrahmens
+        QString expression; // Eingabe wie vom Benutzer eingegeben
+        Expression::Parsed parsed; // Ergebnis von Expression::parse()
+        QString cacheKey;   // Kanonische Form für den Ergebnis-Cache, leer: nicht speichern
+        QByteArray wire;    // Bytes, die tatsächlich gesendet werden
+        qint64 sentAt;      // Zeitpunkt des Sendens (ms, monoton)
+        qint64 writeEnd;    // Summe aller geschriebenen Bytes nach dieser Anfrage (für bytesWritten)
+        StageTimes times;   // Zeitpunkte der einzelnen Stufen (ns)
+        quint8 seq;         // Sequenznummer im Rahmenprotokoll
+        int retries;        // Anzahl Wiederholungen nach CRC-Fehlern
+        std::vector<Request> batch; // OpCalcBatch: gebündelte Rechnungen, leer bei allen anderen Anfragen
+    };
+
+    void schedulePump();                              // pump() im nächsten Durchlauf der Ereignisschleife
+    void answerLater(quint32 id, const QString &expression, const QString &response, StageTimes times); // Antwort ohne Gerät melden
+    bool shouldOffload() const;                       // Adaptive: Gerät zu langsam oder nicht erreichbar?
+    bool offload(const Request &request);             // Auf dem PC rechnen statt zu scheitern, false bei DeviceOnly
+    void pump();                                      // Sendet wartende Anfragen, solange das Fenster es erlaubt
+    void gatherBatch();                               // Fasst einfache Rechnungen am Anfang der Warteschlange zusammen
+    bool encode(Request &request);                    // Erzeugt die Bytes für den aktuellen Protokollmodus
+    void encodeBatch(Request &request);               // OpCalcBatch, mit gemeinsamem Operator, wenn möglich
+    void handleLines(qint64 receivedAt);              // Textprotokoll: vollständige Zeilen zuordnen
+    void handleFrames(const QByteArray &data, qint64 receivedAt); // Rahmenprotokoll: Antworten über die Sequenznummer zuordnen
+    void retransmit(int index);                       // Anfrage nach Übertragungsfehler erneut senden
+    void finish(int index, const QString &response, bool cacheable = true); // Anfrage mit Antwort abschließen
+    void finishBatch(int index, const QByteArray &payload); // OpResultBatch auf die gebündelten Rechnungen verteilen
+    StageTimes complete(const Request &request);      // Aus inFlight entfernte Anfrage: Zeitpunkte und Antwortzeit
+    void deliver(const Request &request, const QString &response, const StageTimes &times, bool cacheable); // Cache und Signale
+    void fail(int index, const QString &reason);      // Anfrage mit Fehler abschließen
+    void notifyFailed(const Request &request, const QString &reason); // Passendes Fehlersignal senden
+    int findInFlight(quint8 seq) const;               // Index der gesendeten Anfrage mit dieser Sequenznummer
+    quint8 allocateSeq();                             // Nächste freie Sequenznummer (1..255)
+    void armTimeout();                                // Startet den Timer für die älteste gesendete Anfrage
+    void checkIdle();                                 // Meldet idle(), wenn nichts mehr offen ist
+    static int findLineEnd(const QByteArray &buffer); // Ende der ersten vollständigen Zeile
+
+    QSerialPort *serial;               // Serielles Gerät (gehört dem MainWindow)
+    WireMode mode = Framed;            // Aktives Protokoll
+    quint16 features = 0;              // Fähigkeiten des Geräts
+    QQueue<Request> waiting;           // Noch nicht gesendete Anfragen
+    QList<Request> inFlight;           // Gesendete Anfragen in Sendereihenfolge
+    QByteArray rxBuffer;               // Textprotokoll: empfangene, noch nicht vollständige Zeile
+    Protocol::FrameParser frameParser; // Rahmenprotokoll: Zerlegung des Bytestroms
+    QTimer *timeoutTimer;              // Timeout für die älteste gesendete Anfrage
+    QElapsedTimer clock;               // Monotone Uhr für die Sendezeitpunkte
+    quint32 nextId = 1;                // Nächste zu vergebende Anfrage-ID
+    quint8 nextSeq = 1;                // Nächste zu vergebende Sequenznummer
+    QHash<quint8, qint64> expiredSeqs; // Sequenznummer -> Zeitpunkt des Timeouts (ms), ruht timeoutMs lang
+    int windowSize = 4;                // Maximale Anzahl gleichzeitig gesendeter Anfragen
+    int inFlightBytes = 0;             // Summe der Bytes aller gesendeten Anfragen
+    int timeoutMs = 1000;              // Timeout pro Anfrage in ms
+    bool pumpScheduled = false;        // pump() ist bereits eingeplant
+    QCache<QString, QString> resultCache; // LRU: kanonischer Ausdruck -> Antwort des Geräts
+    quint64 cacheHitCount = 0;
+    quint64 cacheMissCount = 0;
+    int answersPending = 0;            // Antworten ohne Gerät, deren Signal noch aussteht
+    OffloadPolicy policy = DeviceOnly; // Verteilung zwischen Gerät und PC
+    qint64 offloadBudgetUs = 50000;    // Adaptive: maximale erwartete Wartezeit auf das Gerät
+    double rttEwmaUs = 0;              // Geglättete Antwortzeit (EWMA, Gewicht 1/8)
+    qint64 stalledSince = -1;          // Letzter Timeout ohne seither empfangene Bytes (ms), -1: keiner
+    quint64 hostCount = 0;             // Auf dem PC beantwortete Anfragen
+    bool floatWire = false;            // OpCalcF32/OpExecF32 statt OpCalc/OpExec
+    int maxBatch = Protocol::MaxBatchCount; // Obergrenze für gebündelte Rechnungen
+    qint64 bytesQueued = 0;            // Seit dem Start an serial->write() übergebene Bytes
+    qint64 bytesFlushed = 0;           // Davon laut bytesWritten beim Treiber abgegeben
+    qint64 partialSince = -1;          // Ankunft des ersten Bytes der unvollständigen Antwort (ns)
+    qint64 lastReceivedAt = -1;        // Ankunft des letzten empfangenen Bytes (ms)
+
+    static constexpr int DeviceRxBufferSize = 64; // Größe des seriellen Empfangspuffers des Arduino
+    static constexpr int SeqCount = 255;          // Sequenznummern 1..255
+    static constexpr int MaxWindowSize = SeqCount - 1; // allocateSeq() findet so immer eine freie Nummer
+    static constexpr int MaxRetries = 2;          // Wiederholungen pro Anfrage nach CRC-Fehlern
+    static constexpr int DefaultCacheSize = 1024; // Ergebnisse im Cache
+};
+
+#endif // REQUESTENGINE_H
@@ -0,0 +1,237 @@
+#include "seriallink.h"
+
+// Alles wird im GUI-Thread angelegt und danach samt Kindern in den I/O-Thread verschoben;
+// die Lambdas mit ioContext als Empfänger laufen damit im I/O-Thread
+SerialLink::SerialLink(QObject *parent)
+    : QObject(parent), ioThread(new QThread(this)), ioContext(new QObject)
+{
+    serial = new QSerialPort(ioContext);
+    engine = new RequestEngine(serial, ioContext);
+    negotiator = new LinkNegotiator(serial, engine, ioContext);
+    monitor = new LinkMonitor(serial, engine, ioContext);
+    cacheEntries = engine->cacheSize();
+
+    connect(engine, &RequestEngine::requestTimed, ioContext, [this](quint32, const StageTimes &times) {
+        lastTimes = times;
+    });
+    connect(engine, &RequestEngine::responseReceived, ioContext,
+            [this](quint32 id, const QString &expression, const QString &response) {
+                post(Event{Event::Response, linkIds.take(id), expression, response, lastTimes});
+            });
+    connect(engine, &RequestEngine::requestFailed, ioContext,
+            [this](quint32 id, const QString &expression, const QString &reason) {
+                post(Event{Event::Failed, linkIds.take(id), expression, reason, StageTimes()});
+            });
+    connect(engine, &RequestEngine::idle, ioContext, [this]() { post(Event{Event::Idle, 0, QString(), QString(), StageTimes()}); });
+    connect(negotiator, &LinkNegotiator::finished, ioContext, [this](bool framed, qint32 baudRate) {
+        handleNegotiated(framed, baudRate);
+    });
+    connect(monitor, &LinkMonitor::connectionStatusChanged, ioContext, [this](bool alive) { handleStatus(alive); });
+
+    ioContext->moveToThread(ioThread);
+    ioThread->start();
+}
+
+SerialLink::~SerialLink()
+{
+    QMetaObject::invokeMethod(ioContext, [this]() { closePort(); }, Qt::BlockingQueuedConnection);
+    ioThread->quit();
+    ioThread->wait();
+    delete ioContext; // Thread ist beendet, Timer und Port sind gestoppt
+}
+
+// Die ID vergibt die Fassade, damit der Aufrufer sie sofort kennt
+quint32 SerialLink::submit(const QString &expression, const Expression::Parsed &parsed, qint64 validatedAt)
+{
+    Submission submission{nextId, expression, parsed, validatedAt};
+    if (!submissions.push(std::move(submission)))
+        return 0;
+    if (!submissionsWake.exchange(true))
+        QMetaObject::invokeMethod(ioContext, [this]() { drainSubmissions(); }, Qt::QueuedConnection);
+    return nextId++;
+}
+
+void SerialLink::open(const QString &portName)
+{
+    QMetaObject::invokeMethod(ioContext, [this, portName]() { openPort(portName); }, Qt::QueuedConnection);
+}
+
+void SerialLink::close()
+{
+    QMetaObject::invokeMethod(ioContext, [this]() { closePort(); }, Qt::QueuedConnection);
+}
+
+void SerialLink::setCacheSize(int entries)
+{
+    cacheEntries = qMax(0, entries);
+    QMetaObject::invokeMethod(ioContext, [this, entries]() { engine->setCacheSize(entries); }, Qt::QueuedConnection);
+}
+
+void SerialLink::setOffloadPolicy(RequestEngine::OffloadPolicy policy)
+{
+    QMetaObject::invokeMethod(ioContext, [this, policy]() { engine->setOffloadPolicy(policy); }, Qt::QueuedConnection);
+}
+
+void SerialLink::setBinaryFloats(bool enabled)
+{
+    QMetaObject::invokeMethod(ioContext, [this, enabled]() { engine->setBinaryFloats(enabled); }, Qt::QueuedConnection);
+}
+
+bool SerialLink::isOpen() const
+{
+    return portOpen.load();
+}
+
+int SerialLink::cacheSize() const
+{
+    return cacheEntries.load();
+}
+
+quint64 SerialLink::cacheHits() const
+{
+    return hits.load(std::memory_order_relaxed);
+}
+
+quint64 SerialLink::cacheMisses() const
+{
+    return misses.load(std::memory_order_relaxed);
+}
+
+quint64 SerialLink::hostEvaluations() const
+{
+    return hostCount.load(std::memory_order_relaxed);
+}
+
+qint64 SerialLink::deviceRttUs() const
+{
+    return rttUs.load(std::memory_order_relaxed);
+}
+
+// QElapsedTimer wird nach dem Start nur noch gelesen, das ist aus jedem Thread erlaubt
+qint64 SerialLink::elapsedNs() const
+{
+    return engine->elapsedNs();
+}
+
+// Erst das Flag löschen, dann leeren: was danach kommt, plant einen neuen Durchlauf ein
+void SerialLink::drainEvents()
+{
+    eventsWake.store(false);
+    Event event;
+    while (events.pop(event))
+    {
+        switch (event.kind)
+        {
+        case Event::Response:
+            emit requestTimed(event.id, event.times);
+            emit responseReceived(event.id, event.expression, event.text);
+            break;
+        case Event::Failed:
+            emit requestFailed(event.id, event.expression, event.text);
+            break;
+        case Event::Idle:
+            emit idle();
+            break;
+        }
+    }
+    if (overflowWaiting.exchange(false))
+        QMetaObject::invokeMethod(ioContext, [this]() { flushOverflow(); }, Qt::QueuedConnection);
+}
+
+void SerialLink::drainSubmissions()
+{
+    submissionsWake.store(false);
+    Submission submission;
+    while (submissions.pop(submission))
+    {
+        const quint32 engineId = engine->enqueue(submission.expression, submission.parsed, submission.validatedAt);
+        linkIds.insert(engineId, submission.id);
+    }
+    publishStats();
+}
+
+void SerialLink::openPort(const QString &portName)
+{
+    if (serial->isOpen())
+        return;
+    serial->setPortName(portName);
+    serial->setBaudRate(Protocol::DefaultBaudRate); // Höhere Rate wird danach ausgehandelt
+    serial->setDataBits(QSerialPort::Data8);
+    serial->setParity(QSerialPort::NoParity);
+    serial->setStopBits(QSerialPort::OneStop);
+    serial->setFlowControl(QSerialPort::NoFlowControl);
+    if (!serial->open(QIODevice::ReadWrite))
+    {
+        emit openFailed(portName, serial->errorString());
+        return;
+    }
+    portOpen = true;
+    emit opened(portName);
+    negotiator->start(DeviceResetDelayMs); // Der Arduino startet beim Öffnen des Ports neu
+}
+
+void SerialLink::closePort()
+{
+    negotiator->cancel();
+    engine->clear();
+    serial->close();
+    monitor->stop();
+    portOpen = false;
+}
+
+// Handshake abgeschlossen: ab jetzt überwacht der LinkMonitor die Verbindung
+void SerialLink::handleNegotiated(bool framed, qint32 baudRate)
+{
+    const Protocol::DeviceInfo &info = negotiator->deviceInfo();
+    engine->setDeviceFeatures(framed ? info.features : 0);
+    monitor->start();
+    emit linkNegotiated(framed, baudRate, framed ? info.version : 0);
+}
+
+void SerialLink::handleStatus(bool alive)
+{
+    if (!alive)
+    {
+        engine->clear(); // Offene Anfragen können nicht mehr beantwortet werden
+        if (serial->isOpen() && serial->error() != QSerialPort::NoError)
+        {
+            serial->close(); // Gerät entfernt: Port freigeben, damit er neu geöffnet werden kann
+            portOpen = false;
+        }
+    }
+    emit connectionStatusChanged(alive);
+}
+
+// Passt ein Ereignis nicht mehr in den Puffer, wartet es im I/O-Thread, bis das
+// Fenster aufgeholt hat; die Reihenfolge bleibt dabei erhalten
+void SerialLink::post(Event &&event)
+{
+    flushOverflow();
+    if (!overflow.isEmpty() || !events.push(std::move(event)))
+    {
+        overflow.enqueue(std::move(event));
+        overflowWaiting = true;
+    }
+    publishStats();
+    if (!eventsWake.exchange(true))
+        QMetaObject::invokeMethod(this, &SerialLink::drainEvents, Qt::QueuedConnection);
+}
+
+void SerialLink::flushOverflow()
+{
+    while (!overflow.isEmpty() && events.push(std::move(overflow.head())))
+        overflow.dequeue();
+    if (overflow.isEmpty())
+        return;
+    overflowWaiting = true;
+    if (!eventsWake.exchange(true))
+        QMetaObject::invokeMethod(this, &SerialLink::drainEvents, Qt::QueuedConnection);
+}
+
+void SerialLink::publishStats()
+{
+    hits.store(engine->cacheHits(), std::memory_order_relaxed);
+    misses.store(engine->cacheMisses(), std::memory_order_relaxed);
+    hostCount.store(engine->hostEvaluations(), std::memory_order_relaxed);
+    rttUs.store(engine->deviceRttUs(), std::memory_order_relaxed);
+}
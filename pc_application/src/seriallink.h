@@ -0,0 +1,122 @@
+#ifndef SERIALLINK_H
+#define SERIALLINK_H
+
+#include <QObject>
+#include <QThread>
+#include <QQueue>
+#include <QHash>
+#include <atomic>
+#include "requestengine.h"
+#include "linkmonitor.h"
+#include "linknegotiator.h"
+#include "expression.h"
+#include "latencystats.h"
+#include "spscqueue.h"
+
+// Verbindung zum Gerät in einem eigenen I/O-Thread: Port, Anfrage-Engine, Handshake
+// und Überwachung leben dort, das Fenster sieht nur diese Fassade. Berechnungen und
+// Antworten laufen über je einen SPSC-Ringpuffer; die Gegenseite wird nur geweckt,
+// wenn sie nicht schon geweckt wurde. Öffnen, Schließen und Einstellungen sind selten
+// und gehen als Queued-Aufruf hinüber. Ein voll beschäftigter GUI-Thread verzögert
+// damit kein Byte auf der Leitung.
+class SerialLink : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SerialLink(QObject *parent = nullptr);
+    ~SerialLink();
+
+    // Nur aus dem GUI-Thread
+    quint32 submit(const QString &expression, const Expression::Parsed &parsed, qint64 validatedAt); // 0: Puffer voll
+    void open(const QString &portName); // Meldet opened() oder openFailed()
+    void close();
+    void setCacheSize(int entries);
+    void setOffloadPolicy(RequestEngine::OffloadPolicy policy);
+    void setBinaryFloats(bool enabled);
+
+    // Aus jedem Thread
+    bool isOpen() const;
+    int cacheSize() const;
+    quint64 cacheHits() const;
+    quint64 cacheMisses() const;
+    quint64 hostEvaluations() const;
+    qint64 deviceRttUs() const;
+    qint64 elapsedNs() const; // Zeitbasis von StageTimes
+
+signals:
+    void opened(const QString &portName);
+    void openFailed(const QString &portName, const QString &error);
+    void linkNegotiated(bool framed, qint32 baudRate, quint8 version); // version 0: alte Firmware
+    void connectionStatusChanged(bool isConnected);
+    void responseReceived(quint32 id, const QString &expression, const QString &response);
+    void requestFailed(quint32 id, const QString &expression, const QString &reason);
+    void requestTimed(quint32 id, const StageTimes &times); // Direkt vor responseReceived
+    void idle();
+
+private:
+    struct Submission
+    {
+        quint32 id = 0;
+        QString expression;
+        Expression::Parsed parsed;
+        qint64 validatedAt = -1;
+    };
+
+    struct Event
+    {
+        enum Kind
+        {
+            Response,
+            Failed,
+            Idle
+        };
+        Kind kind = Idle;
+        quint32 id = 0;
+        QString expression;
+        QString text; // Antwort oder Fehlergrund
+        StageTimes times;
+    };
+
+    // GUI-Thread
+    void drainEvents();
+
+    // I/O-Thread
+    void drainSubmissions();
+    void openPort(const QString &portName);
+    void closePort();
+    void handleNegotiated(bool framed, qint32 baudRate);
+    void handleStatus(bool alive);
+    void post(Event &&event);
+    void flushOverflow();
+    void publishStats();
+
+    QThread *ioThread;
+    QObject *ioContext;           // Lebt im I/O-Thread, Eltern von Port, Engine usw.
+    QSerialPort *serial;
+    RequestEngine *engine;
+    LinkNegotiator *negotiator;
+    LinkMonitor *monitor;
+
+    SpscQueue<Submission> submissions{1024}; // GUI -> I/O
+    SpscQueue<Event> events{4096};           // I/O -> GUI
+    std::atomic<bool> submissionsWake{false}; // drainSubmissions() ist eingeplant
+    std::atomic<bool> eventsWake{false};      // drainEvents() ist eingeplant
+    std::atomic<bool> overflowWaiting{false}; // I/O-Thread hat Ereignisse, die nicht mehr in den Puffer passten
+    quint32 nextId = 1;                       // GUI-Thread
+
+    QHash<quint32, quint32> linkIds; // I/O-Thread: Anfrage-ID der Engine -> eigene ID
+    QQueue<Event> overflow;          // I/O-Thread: wartet auf Platz in events
+    StageTimes lastTimes;            // I/O-Thread: aus requestTimed, gehört zur nächsten Antwort
+
+    std::atomic<bool> portOpen{false};
+    std::atomic<int> cacheEntries{0};
+    std::atomic<quint64> hits{0};
+    std::atomic<quint64> misses{0};
+    std::atomic<quint64> hostCount{0};
+    std::atomic<qint64> rttUs{0};
+
+    static constexpr int DeviceResetDelayMs = 1500; // Bootloader-Zeit des Arduino nach dem Öffnen des Ports
+};
+
+#endif // SERIALLINK_H
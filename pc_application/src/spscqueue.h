@@ -0,0 +1,69 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Ringpuffer ohne Sperren für genau einen schreibenden und einen lesenden Thread.
+// Jede Seite schreibt nur ihren eigenen Index und merkt sich den der Gegenseite,
+// bis der Puffer scheinbar voll bzw. leer ist; erst dann wird er neu gelesen.
+template <typename T>
+class SpscQueue
+{
+public:
+    explicit SpscQueue(size_t capacity) // Wird auf eine Zweierpotenz aufgerundet
+    {
+        size_t size = 2;
+        while (size < capacity)
+            size *= 2;
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    SpscQueue(const SpscQueue &) = delete;
+    SpscQueue &operator=(const SpscQueue &) = delete;
+
+    // Nur vom schreibenden Thread, false wenn der Puffer voll ist (value bleibt dann unverändert)
+    bool push(T &&value)
+    {
+        const size_t tail = tailIndex.load(std::memory_order_relaxed);
+        if (tail - headCache == slots.size())
+        {
+            headCache = headIndex.load(std::memory_order_acquire);
+            if (tail - headCache == slots.size())
+                return false;
+        }
+        slots[tail & mask] = std::move(value);
+        tailIndex.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Nur vom lesenden Thread, false wenn der Puffer leer ist
+    bool pop(T &value)
+    {
+        const size_t head = headIndex.load(std::memory_order_relaxed);
+        if (head == tailCache)
+        {
+            tailCache = tailIndex.load(std::memory_order_acquire);
+            if (head == tailCache)
+                return false;
+        }
+        value = std::move(slots[head & mask]);
+        slots[head & mask] = T(); // Strings usw. sofort freigeben, nicht erst beim Überschreiben
+        headIndex.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::vector<T> slots;
+    size_t mask = 0;
+
+    alignas(64) std::atomic<size_t> headIndex{0}; // Nächster zu lesender Platz, schreibt nur der Leser
+    size_t tailCache = 0;                         // Letzter gesehener tailIndex, nur der Leser
+    alignas(64) std::atomic<size_t> tailIndex{0}; // Nächster freier Platz, schreibt nur der Schreiber
+    size_t headCache = 0;                         // Letzter gesehener headIndex, nur der Schreiber
+};
+
+#endif // SPSCQUEUE_H